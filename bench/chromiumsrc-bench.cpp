@@ -0,0 +1,1162 @@
+/**
+ * chromiumsrc-bench.cpp - Frame Path Benchmark for the chromiumsrc Element
+ *
+ * Purpose:
+ *   Measures what a chromiumsrc instance costs, without network access and
+ *   without a display, so numbers can be compared between releases.
+ *
+ * How it works:
+ *   1. For every bundled page (bench/pages/<page>.html) and output size, a
+ *      pipeline "chromiumsrc ! video/x-raw,format=... ! fakesink sync=true"
+ *      is started
+ *   2. After a warm-up (browser start, page load) the element's counters,
+ *      the CPU time of this process and its CEF subprocesses, and a buffer
+ *      probe on the sink are sampled, then sampled again after the run
+ *   3. One JSON object per case is printed on stdout (JSON lines), so runs
+ *      can be stored and diffed; progress goes to stderr
+ *
+ * Reported fields:
+ *   fps              - Buffers reaching the sink per second
+ *   cpu_ms_per_frame - CPU time of the process tree (incl. renderer and GPU
+ *                      subprocesses) per output frame
+ *   cpu_ms_per_frame_self - The same for this process alone (CEF UI thread,
+ *                      OnPaint copy, streaming thread)
+ *   bytes_per_paint  - Bytes OnPaint() wrote per paint (shows dirty-rects,
+ *                      which is enabled as fakesink never writes to buffers)
+ *   paint_to_sink_ms_* - How long after OnPaint() finished copying a new
+ *                      frame it reached the sink, from the frame's paint
+ *                      reference timestamp (repeats are not counted)
+ *
+ * Soak mode (--soak=N):
+ *   Runs 1, 2, ... N instances of the first page and size at the same time,
+ *   as separate pipelines in this process or, with --processes, as one child
+ *   process per instance (this binary re-executed with --child). Every step
+ *   prints per-instance frame rate stability sampled once a second, the peak
+ *   RSS and PSS of the whole process tree including the chromiumsrc-subprocess
+ *   renderer and GPU processes, and the run stops at the knee: the first step
+ *   where instances fall below 90% of the framerate or total throughput drops
+ *   more than 2% below the previous step's.
+ *
+ * Restart mode (--restarts=N):
+ *   Cycles each page and size N times PLAYING -> READY -> PLAYING, once
+ *   with keep-browser=true and once with false, and prints how long the
+ *   first buffer took after every return to PLAYING.
+ *
+ * Usage:
+ *   make bench
+ *   make bench BENCH_ARGS="--pages=canvas --sizes=4k --seconds=30"
+ *   make bench BENCH_ARGS="--soak=16 --pages=animation --sizes=720p --processes"
+ *   make bench BENCH_ARGS="--restarts=10 --pages=static --sizes=1080p"
+ */
+
+#include <gst/gst.h>
+#include <glib.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+typedef struct {
+    const gchar *name;
+    gint width;
+    gint height;
+} BenchSize;
+
+static const BenchSize bench_sizes[] = {
+    { "720p", 1280, 720 },
+    { "1080p", 1920, 1080 },
+    { "4k", 3840, 2160 },
+};
+
+/* Command line options */
+static gchar *opt_pages = NULL;
+static gchar *opt_sizes = NULL;
+static gchar *opt_pages_dir = NULL;
+static gchar *opt_framerate = NULL;
+static gchar *opt_format = NULL;
+static gchar *opt_gpu = NULL;
+static gdouble opt_seconds = 10.0;
+static gdouble opt_warmup = 3.0;
+static gint opt_soak = 0;
+static gboolean opt_processes = FALSE;
+static gboolean opt_child = FALSE;
+static gint opt_restarts = 0;
+
+/* Must match GST_CHROMIUM_SRC_PAINT_CAPS and
+ * GST_CHROMIUM_SRC_REPEAT_META_NAME in gstchromiumsrc.h */
+#define BENCH_PAINT_CAPS "timestamp/x-chromiumsrc-paint"
+#define BENCH_REPEAT_META_NAME "GstChromiumSrcRepeatMeta"
+
+static GstCaps *paint_caps = NULL;
+
+/* Soak knee thresholds: an instance averaging below this share of the
+ * framerate, or total throughput falling below this share of the
+ * previous step's, ends the run. The slack keeps jitter in the total
+ * from ending it early once many instances share the machine. */
+#define BENCH_SOAK_MIN_RATE 0.9
+#define BENCH_SOAK_MIN_TOTAL 0.98
+
+static GOptionEntry bench_options[] = {
+    { "pages", 0, 0, G_OPTION_ARG_STRING, &opt_pages,
+      "Comma separated pages to render (default: static,animation,canvas,webgl)", "LIST" },
+    { "sizes", 0, 0, G_OPTION_ARG_STRING, &opt_sizes,
+      "Comma separated output sizes: 720p, 1080p, 4k (default: all)", "LIST" },
+    { "pages-dir", 0, 0, G_OPTION_ARG_FILENAME, &opt_pages_dir,
+      "Directory holding <page>.html (default: pages/ next to the binary)", "DIR" },
+    { "framerate", 0, 0, G_OPTION_ARG_STRING, &opt_framerate,
+      "Output framerate (default: 30/1)", "FPS" },
+    { "format", 0, 0, G_OPTION_ARG_STRING, &opt_format,
+      "Output format: BGRA, BGRx, I420, NV12 (default: BGRA)", "FORMAT" },
+    { "gpu", 0, 0, G_OPTION_ARG_STRING, &opt_gpu,
+      "gpu property of the element; false runs WebGL on SwiftShader (default: false)", "MODE" },
+    { "seconds", 0, 0, G_OPTION_ARG_DOUBLE, &opt_seconds,
+      "Measured seconds per case (default: 10)", "S" },
+    { "warmup", 0, 0, G_OPTION_ARG_DOUBLE, &opt_warmup,
+      "Seconds to run before measuring (default: 3)", "S" },
+    { "soak", 0, 0, G_OPTION_ARG_INT, &opt_soak,
+      "Scale from 1 to N concurrent instances of the first page and size", "N" },
+    { "processes", 0, 0, G_OPTION_ARG_NONE, &opt_processes,
+      "Soak with one process per instance instead of one shared process", NULL },
+    { "restarts", 0, 0, G_OPTION_ARG_INT, &opt_restarts,
+      "Measure time to first buffer over N READY/PLAYING cycles per case", "N" },
+    { "child", 0, G_OPTION_FLAG_HIDDEN, G_OPTION_ARG_NONE, &opt_child,
+      "Run one instance and report its per-second frame rates to the parent", NULL },
+    { NULL }
+};
+
+/**
+ * BenchProbe - Counters updated by the buffer probe on the sink pad
+ */
+typedef struct {
+    GMutex lock;
+    guint64 frames;
+    guint64 latency_count;
+    GstClockTime latency_sum;
+    GstClockTime latency_max;
+} BenchProbe;
+
+/**
+ * BenchSnapshot - Everything sampled at the start and end of a run
+ */
+typedef struct {
+    gint64 time;
+    gdouble cpu_self;
+    gdouble cpu_tree;
+    guint64 paints;
+    guint64 bytes;
+    guint64 repeats;
+    guint64 dropped;
+    BenchProbe probe;
+} BenchSnapshot;
+
+/**
+ * BenchInstance - One running chromiumsrc pipeline
+ */
+typedef struct {
+    GstElement *pipeline;
+    GstElement *src;
+    GstPad *pad;
+    GstBus *bus;
+    BenchProbe probe;
+} BenchInstance;
+
+/**
+ * BenchMemory - Memory of a process tree in kB
+ */
+typedef struct {
+    guint64 rss;
+    guint64 pss;
+} BenchMemory;
+
+/**
+ * bench_read_cpu:
+ * @pid: Process to read
+ * @ppid: Output location for the parent process id
+ *
+ * Reads the user and system CPU time of a process from /proc.
+ *
+ * Returns: CPU seconds, or -1 if the process could not be read
+ */
+static gdouble bench_read_cpu(gint pid, gint *ppid) {
+    gchar *path = g_strdup_printf("/proc/%d/stat", pid);
+    gchar *contents = NULL;
+    gdouble seconds = -1;
+
+    if (g_file_get_contents(path, &contents, NULL, NULL)) {
+        // The command may contain spaces, fields restart after its ')'
+        const gchar *fields = strrchr(contents, ')');
+        gchar **parts = fields ? g_strsplit(fields + 2, " ", 0) : NULL;
+
+        // state ppid ... utime(14) stime(15), counted from state as 3
+        if (parts && g_strv_length(parts) > 12) {
+            *ppid = atoi(parts[1]);
+            seconds = (g_ascii_strtod(parts[11], NULL) + g_ascii_strtod(parts[12], NULL)) /
+                      sysconf(_SC_CLK_TCK);
+        }
+        g_strfreev(parts);
+        g_free(contents);
+    }
+    g_free(path);
+
+    return seconds;
+}
+
+/**
+ * bench_read_memory:
+ * @pid: Process to read
+ * @memory: Memory to add the process's RSS and PSS to
+ *
+ * Reads resident and proportional set size from /proc. PSS splits
+ * pages shared between CEF processes fairly, so it adds up across the
+ * tree where RSS double counts.
+ */
+static void bench_read_memory(gint pid, BenchMemory *memory) {
+    const gchar *files[] = { "status", "smaps_rollup" };
+    const gchar *keys[] = { "VmRSS:", "Pss:" };
+    guint64 *values[] = { &memory->rss, &memory->pss };
+
+    for (guint i = 0; i < G_N_ELEMENTS(files); i++) {
+        gchar *path = g_strdup_printf("/proc/%d/%s", pid, files[i]);
+        gchar *contents = NULL;
+
+        if (g_file_get_contents(path, &contents, NULL, NULL)) {
+            const gchar *line = strstr(contents, keys[i]);
+            if (line) {
+                *values[i] += g_ascii_strtoull(line + strlen(keys[i]), NULL, 10);
+            }
+            g_free(contents);
+        }
+        g_free(path);
+    }
+}
+
+/**
+ * bench_process_tree:
+ * @cpu: (nullable): Output location for the CPU seconds of each process
+ *
+ * Lists this process and all its descendants (the CEF renderer, GPU
+ * and utility processes, and soak children with theirs) by walking /proc.
+ *
+ * Returns: Array of pids; the first entry is this process
+ */
+static GArray *bench_process_tree(GArray *cpu) {
+    GHashTable *parents = g_hash_table_new(g_direct_hash, g_direct_equal);
+    GHashTable *seconds = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, g_free);
+    GArray *pids = g_array_new(FALSE, FALSE, sizeof(gint));
+    GDir *dir = g_dir_open("/proc", 0, NULL);
+    GHashTableIter iter;
+    gpointer key, value;
+    const gchar *name;
+    gint me = getpid();
+
+    g_array_append_val(pids, me);
+
+    while (dir && (name = g_dir_read_name(dir))) {
+        gint pid = atoi(name);
+        gint ppid = 0;
+        gdouble used;
+
+        if (pid <= 0 || (used = bench_read_cpu(pid, &ppid)) < 0) {
+            continue;
+        }
+        g_hash_table_insert(parents, GINT_TO_POINTER(pid), GINT_TO_POINTER(ppid));
+        g_hash_table_insert(seconds, GINT_TO_POINTER(pid), g_memdup2(&used, sizeof(used)));
+    }
+    if (dir) {
+        g_dir_close(dir);
+    }
+
+    g_hash_table_iter_init(&iter, parents);
+    while (g_hash_table_iter_next(&iter, &key, &value)) {
+        // Walk up towards init; keep the process if we are an ancestor
+        gint pid = GPOINTER_TO_INT(value);
+        for (gint depth = 0; pid > 1 && depth < 64; depth++) {
+            if (pid == me) {
+                gint child = GPOINTER_TO_INT(key);
+                g_array_append_val(pids, child);
+                break;
+            }
+            pid = GPOINTER_TO_INT(g_hash_table_lookup(parents, GINT_TO_POINTER(pid)));
+        }
+    }
+
+    if (cpu) {
+        for (guint i = 0; i < pids->len; i++) {
+            gdouble *used = (gdouble *)g_hash_table_lookup(seconds,
+                GINT_TO_POINTER(g_array_index(pids, gint, i)));
+            gdouble zero = 0;
+            g_array_append_val(cpu, used ? *used : zero);
+        }
+    }
+
+    g_hash_table_destroy(parents);
+    g_hash_table_destroy(seconds);
+
+    return pids;
+}
+
+/**
+ * bench_sample_cpu:
+ * @self: Output location for the CPU seconds of this process
+ * @tree: Output location for the CPU seconds of this process and all
+ *        its descendants
+ *
+ * Samples CPU usage of the process tree.
+ */
+static void bench_sample_cpu(gdouble *self, gdouble *tree) {
+    GArray *cpu = g_array_new(FALSE, FALSE, sizeof(gdouble));
+    GArray *pids = bench_process_tree(cpu);
+
+    *self = g_array_index(cpu, gdouble, 0);
+    *tree = 0;
+    for (guint i = 0; i < cpu->len; i++) {
+        *tree += g_array_index(cpu, gdouble, i);
+    }
+
+    g_array_free(pids, TRUE);
+    g_array_free(cpu, TRUE);
+}
+
+/**
+ * bench_sample_memory:
+ * @memory: Output memory of this process and all its descendants
+ *
+ * Samples RSS and PSS of the process tree.
+ */
+static void bench_sample_memory(BenchMemory *memory) {
+    GArray *pids = bench_process_tree(NULL);
+
+    memory->rss = 0;
+    memory->pss = 0;
+    for (guint i = 0; i < pids->len; i++) {
+        bench_read_memory(g_array_index(pids, gint, i), memory);
+    }
+
+    g_array_free(pids, TRUE);
+}
+
+/**
+ * bench_probe_buffer:
+ * @pad: The fakesink sink pad
+ * @info: Probe info holding the buffer
+ * @user_data: The BenchProbe
+ *
+ * Counts buffers and, for new frames, measures the paint to sink
+ * latency: the time since OnPaint() stamped the frame with its paint
+ * reference timestamp. Both sides use gst_util_get_timestamp(). Repeats
+ * carry the timestamp of the frame they copy and are left out.
+ *
+ * Invoked on the streaming thread for every buffer.
+ *
+ * Returns: GST_PAD_PROBE_OK always
+ */
+static GstPadProbeReturn bench_probe_buffer(GstPad *pad, GstPadProbeInfo *info, gpointer user_data) {
+    BenchProbe *probe = (BenchProbe *)user_data;
+    GstBuffer *buffer = GST_PAD_PROBE_INFO_BUFFER(info);
+    GstReferenceTimestampMeta *paint = gst_buffer_get_reference_timestamp_meta(buffer, paint_caps);
+    GstClockTime latency = GST_CLOCK_TIME_NONE;
+
+    if (paint && !gst_buffer_get_custom_meta(buffer, BENCH_REPEAT_META_NAME)) {
+        GstClockTime now = gst_util_get_timestamp();
+        latency = now > paint->timestamp ? now - paint->timestamp : 0;
+    }
+
+    g_mutex_lock(&probe->lock);
+    probe->frames++;
+    if (GST_CLOCK_TIME_IS_VALID(latency)) {
+        probe->latency_count++;
+        probe->latency_sum += latency;
+        probe->latency_max = MAX(probe->latency_max, latency);
+    }
+    g_mutex_unlock(&probe->lock);
+
+    return GST_PAD_PROBE_OK;
+}
+
+/**
+ * bench_snapshot:
+ * @src: The chromiumsrc element
+ * @probe: The sink probe counters
+ * @snapshot: Output snapshot
+ *
+ * Samples all counters at one point in time. The probe's latency maximum
+ * is reset so the end snapshot covers the measured run only.
+ */
+static void bench_snapshot(GstElement *src, BenchProbe *probe, BenchSnapshot *snapshot) {
+    snapshot->time = g_get_monotonic_time();
+    bench_sample_cpu(&snapshot->cpu_self, &snapshot->cpu_tree);
+    g_object_get(src,
+        "paint-count", &snapshot->paints,
+        "bytes-copied", &snapshot->bytes,
+        "frames-duplicated", &snapshot->repeats,
+        "frames-dropped", &snapshot->dropped,
+        NULL);
+
+    g_mutex_lock(&probe->lock);
+    snapshot->probe.frames = probe->frames;
+    snapshot->probe.latency_count = probe->latency_count;
+    snapshot->probe.latency_sum = probe->latency_sum;
+    snapshot->probe.latency_max = probe->latency_max;
+    probe->latency_max = 0;
+    g_mutex_unlock(&probe->lock);
+}
+
+/**
+ * bench_wait:
+ * @bus: The pipeline bus
+ * @seconds: How long to run
+ * @error: Output location for the error message
+ *
+ * Lets the pipeline run for @seconds, returning early on errors.
+ *
+ * Returns: TRUE if the pipeline ran without error or EOS
+ */
+static gboolean bench_wait(GstBus *bus, gdouble seconds, gchar **error) {
+    GstMessage *msg = gst_bus_timed_pop_filtered(bus, (GstClockTime)(seconds * GST_SECOND),
+        (GstMessageType)(GST_MESSAGE_ERROR | GST_MESSAGE_EOS));
+
+    if (!msg) {
+        return TRUE;
+    }
+
+    if (GST_MESSAGE_TYPE(msg) == GST_MESSAGE_ERROR) {
+        GError *err = NULL;
+        gst_message_parse_error(msg, &err, NULL);
+        *error = g_strdup(err->message);
+        g_error_free(err);
+    } else {
+        *error = g_strdup("unexpected EOS");
+    }
+    gst_message_unref(msg);
+
+    return FALSE;
+}
+
+/**
+ * bench_print_error:
+ * @page: Page of the failed case
+ * @size: Size of the failed case
+ * @error: What went wrong
+ *
+ * Prints a failed case as a JSON line.
+ */
+static void bench_print_error(const gchar *page, const BenchSize *size, const gchar *error) {
+    gchar *escaped = g_strescape(error, NULL);
+
+    printf("{\"page\":\"%s\",\"size\":\"%s\",\"error\":\"%s\"}\n", page, size->name, escaped);
+    fflush(stdout);
+    g_free(escaped);
+}
+
+/**
+ * bench_instance_new:
+ * @page: Page name, rendered from <pages-dir>/<page>.html
+ * @size: Output size
+ * @error: Output location for the error message
+ *
+ * Builds one chromiumsrc pipeline into a fakesink, with a buffer probe
+ * on the sink, and sets it to PLAYING.
+ *
+ * Returns: The running instance, or NULL on failure
+ */
+static BenchInstance *bench_instance_new(const gchar *page, const BenchSize *size, gchar **error) {
+    gchar *file = g_strdup_printf("%s/%s.html", opt_pages_dir, page);
+    gchar *uri = gst_filename_to_uri(file, NULL);
+    BenchInstance *instance = NULL;
+    GError *err = NULL;
+
+    if (!uri || !g_file_test(file, G_FILE_TEST_EXISTS)) {
+        *error = g_strdup_printf("page not found: %s", file);
+        g_free(uri);
+        g_free(file);
+        return NULL;
+    }
+
+    gchar *description = g_strdup_printf(
+        "chromiumsrc name=src url=\"%s\" width=%d height=%d framerate=%s gpu=%s dirty-rects=true "
+        "! video/x-raw,format=%s ! fakesink name=sink sync=true",
+        uri, size->width, size->height, opt_framerate, opt_gpu, opt_format);
+    GstElement *pipeline = gst_parse_launch(description, &err);
+    g_free(description);
+    g_free(uri);
+    g_free(file);
+
+    if (!pipeline) {
+        *error = g_strdup(err ? err->message : "failed to create pipeline");
+        g_clear_error(&err);
+        return NULL;
+    }
+    g_clear_error(&err);
+
+    instance = g_new0(BenchInstance, 1);
+    g_mutex_init(&instance->probe.lock);
+    instance->pipeline = pipeline;
+    instance->src = gst_bin_get_by_name(GST_BIN(pipeline), "src");
+    instance->bus = gst_element_get_bus(pipeline);
+
+    GstElement *sink = gst_bin_get_by_name(GST_BIN(pipeline), "sink");
+    instance->pad = gst_element_get_static_pad(sink, "sink");
+    gst_object_unref(sink);
+    gst_pad_add_probe(instance->pad, GST_PAD_PROBE_TYPE_BUFFER, bench_probe_buffer,
+        &instance->probe, NULL);
+
+    if (gst_element_set_state(pipeline, GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE) {
+        *error = g_strdup("failed to start pipeline");
+    }
+
+    return instance;
+}
+
+/**
+ * bench_instance_free:
+ * @instance: The instance to stop
+ *
+ * Stops the pipeline and releases the instance.
+ */
+static void bench_instance_free(BenchInstance *instance) {
+    gst_element_set_state(instance->pipeline, GST_STATE_NULL);
+    gst_object_unref(instance->bus);
+    gst_object_unref(instance->pad);
+    gst_object_unref(instance->src);
+    gst_object_unref(instance->pipeline);
+    g_mutex_clear(&instance->probe.lock);
+    g_free(instance);
+}
+
+/**
+ * bench_instance_frames:
+ * @instance: The running instance
+ *
+ * Returns: Buffers that reached the sink so far
+ */
+static guint64 bench_instance_frames(BenchInstance *instance) {
+    g_mutex_lock(&instance->probe.lock);
+    guint64 frames = instance->probe.frames;
+    g_mutex_unlock(&instance->probe.lock);
+
+    return frames;
+}
+
+/**
+ * bench_wait_all:
+ * @instances: The running instances
+ * @n: Number of instances
+ * @seconds: How long to run
+ * @error: Output location for the error message
+ *
+ * Lets all instances run for @seconds, returning early when any of
+ * them posts an error or EOS.
+ *
+ * Returns: TRUE if all instances ran without error
+ */
+static gboolean bench_wait_all(BenchInstance **instances, guint n, gdouble seconds, gchar **error) {
+    gint64 end = g_get_monotonic_time() + (gint64)(seconds * G_USEC_PER_SEC);
+
+    for (;;) {
+        for (guint i = 0; i < n; i++) {
+            if (!bench_wait(instances[i]->bus, 0, error)) {
+                return FALSE;
+            }
+        }
+
+        gint64 left = end - g_get_monotonic_time();
+        if (left <= 0) {
+            return TRUE;
+        }
+        g_usleep(MIN(left, 100 * 1000));
+    }
+}
+
+/**
+ * bench_run_case:
+ * @page: Page name, rendered from <pages-dir>/<page>.html
+ * @size: Output size
+ *
+ * Runs one page at one size and prints its JSON line.
+ *
+ * Returns: TRUE if the case completed
+ */
+static gboolean bench_run_case(const gchar *page, const BenchSize *size) {
+    BenchSnapshot start = {}, end = {};
+    gchar *error = NULL;
+
+    g_printerr("bench: %s at %s\n", page, size->name);
+
+    BenchInstance *instance = bench_instance_new(page, size, &error);
+
+    // Step 1: Warm up (browser start, page load, first frames)
+    // Step 2: Measure
+    if (instance && !error && bench_wait_all(&instance, 1, opt_warmup, &error)) {
+        bench_snapshot(instance->src, &instance->probe, &start);
+        if (bench_wait_all(&instance, 1, opt_seconds, &error)) {
+            bench_snapshot(instance->src, &instance->probe, &end);
+        }
+    }
+    if (instance) {
+        bench_instance_free(instance);
+    }
+
+    if (error || !instance) {
+        bench_print_error(page, size, error ? error : "unknown error");
+        g_free(error);
+        return FALSE;
+    }
+
+    gdouble elapsed = (end.time - start.time) / (gdouble)G_USEC_PER_SEC;
+    guint64 frames = end.probe.frames - start.probe.frames;
+    guint64 paints = end.paints - start.paints;
+    guint64 latencies = end.probe.latency_count - start.probe.latency_count;
+    gdouble per_frame = frames ? 1000.0 / frames : 0;
+
+    printf("{\"page\":\"%s\",\"size\":\"%s\",\"width\":%d,\"height\":%d,"
+           "\"format\":\"%s\",\"framerate\":\"%s\",\"gpu\":\"%s\","
+           "\"seconds\":%.3f,\"frames\":%" G_GUINT64_FORMAT ",\"fps\":%.2f,"
+           "\"paints\":%" G_GUINT64_FORMAT ",\"repeats\":%" G_GUINT64_FORMAT
+           ",\"dropped\":%" G_GUINT64_FORMAT ","
+           "\"cpu_ms_per_frame\":%.3f,\"cpu_ms_per_frame_self\":%.3f,"
+           "\"bytes_per_paint\":%.0f,"
+           "\"paint_to_sink_ms_avg\":%.3f,\"paint_to_sink_ms_max\":%.3f}\n",
+           page, size->name, size->width, size->height,
+           opt_format, opt_framerate, opt_gpu,
+           elapsed, frames, frames / elapsed,
+           paints, end.repeats - start.repeats, end.dropped - start.dropped,
+           (end.cpu_tree - start.cpu_tree) * per_frame,
+           (end.cpu_self - start.cpu_self) * per_frame,
+           paints ? (gdouble)(end.bytes - start.bytes) / paints : 0.0,
+           latencies ? (end.probe.latency_sum - start.probe.latency_sum) / (gdouble)latencies / GST_MSECOND
+                     : 0.0,
+           end.probe.latency_max / (gdouble)GST_MSECOND);
+    fflush(stdout);
+
+    return TRUE;
+}
+
+/**
+ * bench_first_buffer:
+ * @instance: The instance just set to PLAYING
+ * @frames: Buffers counted before
+ * @error: Output location for the error message
+ *
+ * Polls the sink probe until a new buffer arrives, for at most 30 s.
+ *
+ * Returns: Microseconds until the first buffer, or -1 on failure
+ */
+static gint64 bench_first_buffer(BenchInstance *instance, guint64 frames, gchar **error) {
+    gint64 start = g_get_monotonic_time();
+
+    while (bench_instance_frames(instance) == frames) {
+        if (!bench_wait(instance->bus, 0, error)) {
+            return -1;
+        }
+        if (g_get_monotonic_time() - start > 30 * G_USEC_PER_SEC) {
+            *error = g_strdup("no buffer within 30 s");
+            return -1;
+        }
+        g_usleep(500);
+    }
+
+    return g_get_monotonic_time() - start;
+}
+
+/**
+ * bench_run_restarts:
+ * @page: Page name, rendered from <pages-dir>/<page>.html
+ * @size: Output size
+ * @keep_browser: Value of the element's keep-browser property
+ *
+ * Starts one instance, measures its time to first buffer, then cycles
+ * it through READY and back to PLAYING --restarts times, measuring
+ * again after each cycle, and prints one JSON line.
+ *
+ * Returns: TRUE if every cycle produced a buffer
+ */
+static gboolean bench_run_restarts(const gchar *page, const BenchSize *size, gboolean keep_browser) {
+    gint64 started = g_get_monotonic_time();
+    gint64 first = -1, sum = 0, worst = 0, best = G_MAXINT64;
+    gchar *error = NULL;
+    gint done = 0;
+
+    g_printerr("bench: %s at %s, %d restarts with keep-browser=%s\n",
+        page, size->name, opt_restarts, keep_browser ? "true" : "false");
+
+    BenchInstance *instance = bench_instance_new(page, size, &error);
+
+    if (instance && !error) {
+        g_object_set(instance->src, "keep-browser", keep_browser, NULL);
+        // Counted from pipeline creation, so it includes browser startup
+        if (bench_first_buffer(instance, 0, &error) >= 0) {
+            first = g_get_monotonic_time() - started;
+        }
+    }
+
+    for (; first >= 0 && !error && done < opt_restarts; done++) {
+        // Settle, then go back to READY like a playout system between segments
+        if (!bench_wait_all(&instance, 1, 1.0, &error)) {
+            break;
+        }
+        gst_element_set_state(instance->pipeline, GST_STATE_READY);
+        gst_element_get_state(instance->pipeline, NULL, NULL, GST_CLOCK_TIME_NONE);
+
+        guint64 frames = bench_instance_frames(instance);
+        if (gst_element_set_state(instance->pipeline, GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE) {
+            error = g_strdup("failed to restart pipeline");
+            break;
+        }
+        gint64 took = bench_first_buffer(instance, frames, &error);
+        if (took < 0) {
+            break;
+        }
+        sum += took;
+        worst = MAX(worst, took);
+        best = MIN(best, took);
+    }
+    if (instance) {
+        bench_instance_free(instance);
+    }
+
+    if (error || !instance) {
+        bench_print_error(page, size, error ? error : "unknown error");
+        g_free(error);
+        return FALSE;
+    }
+
+    printf("{\"mode\":\"restart\",\"page\":\"%s\",\"size\":\"%s\",\"keep_browser\":%s,"
+           "\"restarts\":%d,\"first_start_ms\":%.1f,\"restart_ms_avg\":%.1f,"
+           "\"restart_ms_min\":%.1f,\"restart_ms_max\":%.1f}\n",
+           page, size->name, keep_browser ? "true" : "false", done,
+           first / 1000.0, done ? sum / 1000.0 / done : 0.0,
+           done ? best / 1000.0 : 0.0, worst / 1000.0);
+    fflush(stdout);
+
+    return TRUE;
+}
+
+/**
+ * bench_framerate:
+ *
+ * Returns: The --framerate option as frames per second
+ */
+static gdouble bench_framerate(void) {
+    GValue value = G_VALUE_INIT;
+    gdouble fps = 30.0;
+
+    g_value_init(&value, GST_TYPE_FRACTION);
+    if (gst_value_deserialize(&value, opt_framerate)) {
+        gst_util_fraction_to_double(gst_value_get_fraction_numerator(&value),
+            gst_value_get_fraction_denominator(&value), &fps);
+    }
+    g_value_unset(&value);
+
+    return fps;
+}
+
+/**
+ * bench_run_child:
+ * @page: Page name
+ * @size: Output size
+ *
+ * Body of a soak child process: runs one instance through warm-up and
+ * measurement and prints its frame rate for every measured second on
+ * one line ("fps 29.9 30.0 ...") for the parent to collect.
+ *
+ * Returns: Process exit code
+ */
+static gint bench_run_child(const gchar *page, const BenchSize *size) {
+    gchar *error = NULL;
+    BenchInstance *instance = bench_instance_new(page, size, &error);
+    GString *line = g_string_new("fps");
+
+    if (instance && !error && bench_wait_all(&instance, 1, opt_warmup, &error)) {
+        guint64 frames = bench_instance_frames(instance);
+        gint64 time = g_get_monotonic_time();
+
+        for (gint second = 0; second < (gint)opt_seconds; second++) {
+            if (!bench_wait_all(&instance, 1, 1.0, &error)) {
+                break;
+            }
+            guint64 now_frames = bench_instance_frames(instance);
+            gint64 now = g_get_monotonic_time();
+            g_string_append_printf(line, " %.2f",
+                (now_frames - frames) * (gdouble)G_USEC_PER_SEC / (now - time));
+            frames = now_frames;
+            time = now;
+        }
+    }
+    if (instance) {
+        bench_instance_free(instance);
+    }
+
+    if (error || !instance) {
+        printf("error %s\n", error ? error : "unknown error");
+    } else {
+        printf("%s\n", line->str);
+    }
+    fflush(stdout);
+    g_string_free(line, TRUE);
+
+    gboolean ok = instance && !error;
+    g_free(error);
+    return ok ? 0 : 1;
+}
+
+/**
+ * BenchSoakStep - Result of one soak step
+ */
+typedef struct {
+    guint instances;
+    guint failed;
+    GArray *samples;        /* Per-second frame rates of all instances */
+    GArray *means;          /* Mean frame rate of each instance */
+    BenchMemory peak;
+    gchar *error;
+} BenchSoakStep;
+
+/**
+ * bench_soak_sample_memory:
+ * @step: The running step
+ *
+ * Records the peak memory of the process tree.
+ */
+static void bench_soak_sample_memory(BenchSoakStep *step) {
+    BenchMemory memory;
+
+    bench_sample_memory(&memory);
+    step->peak.rss = MAX(step->peak.rss, memory.rss);
+    step->peak.pss = MAX(step->peak.pss, memory.pss);
+}
+
+/**
+ * bench_soak_in_process:
+ * @page: Page name
+ * @size: Output size
+ * @step: The step to run and fill
+ *
+ * Runs step->instances pipelines side by side in this process, sharing
+ * CEF, and samples every instance's frame rate once a second.
+ */
+static void bench_soak_in_process(const gchar *page, const BenchSize *size, BenchSoakStep *step) {
+    BenchInstance **instances = g_new0(BenchInstance *, step->instances);
+    guint64 *frames = g_new0(guint64, step->instances);
+    gdouble *sums = g_new0(gdouble, step->instances);
+    guint n = 0, seconds = 0;
+
+    for (; n < step->instances; n++) {
+        instances[n] = bench_instance_new(page, size, &step->error);
+        if (!instances[n] || step->error) {
+            if (instances[n]) {
+                n++;
+            }
+            goto out;
+        }
+    }
+
+    if (!bench_wait_all(instances, n, opt_warmup, &step->error)) {
+        goto out;
+    }
+
+    {
+        gint64 time = g_get_monotonic_time();
+        for (guint i = 0; i < n; i++) {
+            frames[i] = bench_instance_frames(instances[i]);
+        }
+
+        for (; seconds < (guint)opt_seconds; seconds++) {
+            if (!bench_wait_all(instances, n, 1.0, &step->error)) {
+                goto out;
+            }
+            gint64 now = g_get_monotonic_time();
+            for (guint i = 0; i < n; i++) {
+                guint64 now_frames = bench_instance_frames(instances[i]);
+                gdouble fps = (now_frames - frames[i]) * (gdouble)G_USEC_PER_SEC / (now - time);
+                g_array_append_val(step->samples, fps);
+                sums[i] += fps;
+                frames[i] = now_frames;
+            }
+            time = now;
+            bench_soak_sample_memory(step);
+        }
+    }
+
+    for (guint i = 0; i < n; i++) {
+        gdouble mean = seconds ? sums[i] / seconds : 0;
+        g_array_append_val(step->means, mean);
+    }
+
+out:
+    for (guint i = 0; i < n; i++) {
+        bench_instance_free(instances[i]);
+    }
+    g_free(instances);
+    g_free(frames);
+    g_free(sums);
+}
+
+/**
+ * bench_soak_processes:
+ * @argv0: Path of this binary
+ * @page: Page name
+ * @size: Output size
+ * @step: The step to run and fill
+ *
+ * Runs step->instances child processes with one pipeline each, every
+ * child with its own CEF, and collects their per-second frame rates.
+ */
+static void bench_soak_processes(const gchar *argv0, const gchar *page, const BenchSize *size,
+                                 BenchSoakStep *step) {
+    GPid *pids = g_new0(GPid, step->instances);
+    gint *outs = g_new(gint, step->instances);
+    gchar *seconds = g_strdup_printf("--seconds=%g", opt_seconds);
+    gchar *warmup = g_strdup_printf("--warmup=%g", opt_warmup);
+    gchar *pages = g_strdup_printf("--pages=%s", page);
+    gchar *sizes = g_strdup_printf("--sizes=%s", size->name);
+    gchar *pages_dir = g_strdup_printf("--pages-dir=%s", opt_pages_dir);
+    gchar *framerate = g_strdup_printf("--framerate=%s", opt_framerate);
+    gchar *format = g_strdup_printf("--format=%s", opt_format);
+    gchar *gpu = g_strdup_printf("--gpu=%s", opt_gpu);
+    const gchar *argv[] = {
+        argv0, "--child", pages, sizes, pages_dir, framerate, format, gpu, warmup, seconds, NULL
+    };
+    guint started = 0;
+
+    for (; started < step->instances; started++) {
+        GError *err = NULL;
+        outs[started] = -1;
+        if (!g_spawn_async_with_pipes(NULL, (gchar **)argv, NULL, G_SPAWN_DO_NOT_REAP_CHILD,
+                                      NULL, NULL, &pids[started], NULL, &outs[started], NULL, &err)) {
+            step->error = g_strdup(err->message);
+            g_error_free(err);
+            break;
+        }
+    }
+
+    // Sample memory while the children run, then collect their reports
+    gint64 end = g_get_monotonic_time() + (gint64)((opt_warmup + opt_seconds) * G_USEC_PER_SEC);
+    g_usleep((gulong)(opt_warmup * G_USEC_PER_SEC));
+    while (g_get_monotonic_time() < end) {
+        bench_soak_sample_memory(step);
+        g_usleep(G_USEC_PER_SEC);
+    }
+
+    for (guint i = 0; i < started; i++) {
+        GIOChannel *channel = g_io_channel_unix_new(outs[i]);
+        gchar *line = NULL;
+
+        g_io_channel_set_close_on_unref(channel, TRUE);
+        if (g_io_channel_read_line(channel, &line, NULL, NULL, NULL) == G_IO_STATUS_NORMAL &&
+            g_str_has_prefix(line, "fps")) {
+            gchar **values = g_strsplit(g_strstrip(line + 3), " ", -1);
+            gdouble sum = 0;
+            guint count = 0;
+            for (gchar **value = values; *value && **value; value++, count++) {
+                gdouble fps = g_ascii_strtod(*value, NULL);
+                g_array_append_val(step->samples, fps);
+                sum += fps;
+            }
+            gdouble mean = count ? sum / count : 0;
+            g_array_append_val(step->means, mean);
+            g_strfreev(values);
+        } else {
+            step->failed++;
+            if (!step->error) {
+                step->error = g_strdup(line && g_str_has_prefix(line, "error ")
+                    ? g_strstrip(line + 6) : "child failed");
+            }
+        }
+        g_free(line);
+        g_io_channel_unref(channel);
+
+        waitpid(pids[i], NULL, 0);
+        g_spawn_close_pid(pids[i]);
+    }
+
+    g_free(pids);
+    g_free(outs);
+    g_free(seconds);
+    g_free(warmup);
+    g_free(pages);
+    g_free(sizes);
+    g_free(pages_dir);
+    g_free(framerate);
+    g_free(format);
+    g_free(gpu);
+}
+
+/**
+ * bench_run_soak:
+ * @argv0: Path of this binary, re-executed for --processes
+ * @page: Page name
+ * @size: Output size
+ *
+ * Scales from 1 to --soak instances and prints one JSON line per step,
+ * then a summary line with the knee: the first step where an instance
+ * averages below 90% of the framerate or total throughput fell more
+ * than 2% below the previous step's.
+ *
+ * Returns: TRUE if every step ran without errors
+ */
+static gboolean bench_run_soak(const gchar *argv0, const gchar *page, const BenchSize *size) {
+    const gdouble target = bench_framerate();
+    gdouble previous_total = 0;
+    guint knee = 0;
+    gboolean ok = TRUE;
+
+    for (guint n = 1; n <= (guint)opt_soak && !knee; n++) {
+        BenchSoakStep step = {};
+        step.instances = n;
+        step.samples = g_array_new(FALSE, FALSE, sizeof(gdouble));
+        step.means = g_array_new(FALSE, FALSE, sizeof(gdouble));
+
+        g_printerr("bench: soak %s at %s with %u instance(s)%s\n",
+            page, size->name, n, opt_processes ? " in separate processes" : "");
+
+        if (opt_processes) {
+            bench_soak_processes(argv0, page, size, &step);
+        } else {
+            bench_soak_in_process(page, size, &step);
+        }
+
+        gdouble total = 0, worst_mean = step.means->len ? G_MAXDOUBLE : 0;
+        for (guint i = 0; i < step.means->len; i++) {
+            gdouble mean = g_array_index(step.means, gdouble, i);
+            total += mean;
+            worst_mean = MIN(worst_mean, mean);
+        }
+
+        gdouble sample_mean = 0, variance = 0, worst_second = step.samples->len ? G_MAXDOUBLE : 0;
+        for (guint i = 0; i < step.samples->len; i++) {
+            gdouble fps = g_array_index(step.samples, gdouble, i);
+            sample_mean += fps / step.samples->len;
+            worst_second = MIN(worst_second, fps);
+        }
+        for (guint i = 0; i < step.samples->len; i++) {
+            gdouble delta = g_array_index(step.samples, gdouble, i) - sample_mean;
+            variance += delta * delta / step.samples->len;
+        }
+
+        gchar *escaped = g_strescape(step.error ? step.error : "", NULL);
+        printf("{\"mode\":\"soak\",\"processes\":%s,\"page\":\"%s\",\"size\":\"%s\","
+               "\"framerate\":\"%s\",\"instances\":%u,\"completed\":%u,"
+               "\"fps_total\":%.2f,\"fps_mean\":%.2f,\"fps_worst_instance\":%.2f,"
+               "\"fps_worst_second\":%.2f,\"fps_stddev\":%.3f,"
+               "\"rss_mb_peak\":%.1f,\"pss_mb_peak\":%.1f,\"error\":\"%s\"}\n",
+               opt_processes ? "true" : "false", page, size->name, opt_framerate,
+               n, step.means->len, total, sample_mean, worst_mean, worst_second,
+               sqrt(variance), step.peak.rss / 1024.0, step.peak.pss / 1024.0, escaped);
+        fflush(stdout);
+        g_free(escaped);
+
+        if (step.error || step.means->len < n) {
+            ok = FALSE;
+            knee = n;
+        } else if (worst_mean < BENCH_SOAK_MIN_RATE * target ||
+                   total < BENCH_SOAK_MIN_TOTAL * previous_total) {
+            knee = n;
+        }
+        previous_total = total;
+
+        g_array_free(step.samples, TRUE);
+        g_array_free(step.means, TRUE);
+        g_free(step.error);
+    }
+
+    if (knee) {
+        printf("{\"mode\":\"soak\",\"summary\":true,\"knee_instances\":%u,\"max_stable_instances\":%u}\n",
+               knee, knee - 1);
+    } else {
+        printf("{\"mode\":\"soak\",\"summary\":true,\"knee_instances\":null,\"max_stable_instances\":%d}\n",
+               opt_soak);
+    }
+    fflush(stdout);
+
+    return ok;
+}
+
+/**
+ * bench_find_size:
+ * @name: Size name from the command line
+ *
+ * Returns: The matching size, or NULL
+ */
+static const BenchSize *bench_find_size(const gchar *name) {
+    for (guint i = 0; i < G_N_ELEMENTS(bench_sizes); i++) {
+        if (g_ascii_strcasecmp(bench_sizes[i].name, name) == 0) {
+            return &bench_sizes[i];
+        }
+    }
+    return NULL;
+}
+
+int main(int argc, char *argv[]) {
+    GOptionContext *context = g_option_context_new("- chromiumsrc frame path benchmark");
+    GError *err = NULL;
+    gchar **pages, **sizes;
+    gboolean ok = TRUE;
+
+    g_option_context_add_main_entries(context, bench_options, NULL);
+    g_option_context_add_group(context, gst_init_get_option_group());
+    if (!g_option_context_parse(context, &argc, &argv, &err)) {
+        g_printerr("bench: %s\n", err->message);
+        g_error_free(err);
+        g_option_context_free(context);
+        return 2;
+    }
+    g_option_context_free(context);
+
+    paint_caps = gst_caps_new_empty_simple(BENCH_PAINT_CAPS);
+
+    if (!opt_pages_dir) {
+        gchar *dir = g_path_get_dirname(argv[0]);
+        opt_pages_dir = g_build_filename(dir, "pages", NULL);
+        g_free(dir);
+    }
+    if (!g_path_is_absolute(opt_pages_dir)) {
+        gchar *cwd = g_get_current_dir();
+        gchar *absolute = g_build_filename(cwd, opt_pages_dir, NULL);
+        g_free(cwd);
+        g_free(opt_pages_dir);
+        opt_pages_dir = absolute;
+    }
+    if (!opt_framerate) opt_framerate = g_strdup("30/1");
+    if (!opt_format) opt_format = g_strdup("BGRA");
+    if (!opt_gpu) opt_gpu = g_strdup("false");
+
+    pages = g_strsplit(opt_pages ? opt_pages : "static,animation,canvas,webgl", ",", -1);
+    sizes = g_strsplit(opt_sizes ? opt_sizes : "720p,1080p,4k", ",", -1);
+
+    for (gchar **name = sizes; *name; name++) {
+        if (!bench_find_size(*name)) {
+            g_printerr("bench: unknown size '%s'\n", *name);
+            g_strfreev(pages);
+            g_strfreev(sizes);
+            return 2;
+        }
+    }
+
+    if (opt_child) {
+        ok = bench_run_child(pages[0], bench_find_size(sizes[0])) == 0;
+    } else if (opt_soak > 0) {
+        ok = bench_run_soak(argv[0], pages[0], bench_find_size(sizes[0]));
+    } else if (opt_restarts > 0) {
+        for (gchar **page = pages; *page; page++) {
+            for (gchar **name = sizes; *name; name++) {
+                ok &= bench_run_restarts(*page, bench_find_size(*name), TRUE);
+                ok &= bench_run_restarts(*page, bench_find_size(*name), FALSE);
+            }
+        }
+    } else {
+        for (gchar **page = pages; *page; page++) {
+            for (gchar **name = sizes; *name; name++) {
+                ok &= bench_run_case(*page, bench_find_size(*name));
+            }
+        }
+    }
+
+    g_strfreev(pages);
+    g_strfreev(sizes);
+    gst_caps_unref(paint_caps);
+
+    return ok ? 0 : 1;
+}
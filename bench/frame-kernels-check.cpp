@@ -0,0 +1,186 @@
+/**
+ * frame-kernels-check.cpp - SIMD Kernel Check for frame_utils
+ *
+ * Purpose:
+ *   Makes sure the AVX2 (x86, when the CPU has it) and NEON (aarch64) row
+ *   kernels of frame_utils.cpp produce exactly the bytes of the portable C
+ *   kernels they replace, so a change to either side cannot silently alter
+ *   the output of some CPUs only.
+ *
+ * How it works:
+ *   frame_utils.cpp is compiled into this program, which gives access to
+ *   its static kernels. Every kernel runs on the same random rows as its C
+ *   reference, for every width from 1 to 67 pixels (all tail lengths of
+ *   the 8-pixel SIMD loops, odd widths included) and a few frame widths,
+ *   with three color matrices and both chroma layouts. The first byte that
+ *   differs is reported and the check fails. Needs only GLib.
+ *
+ * Usage:
+ *   make check-kernels, also run by make test and make bench
+ *   bench/frame-kernels-check [seed]
+ */
+
+#include "../frame_utils.cpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define CHECK_ROWS_PER_WIDTH 16
+
+static const gint check_widths[] = { 127, 1279, 1919, 3839 };
+
+/**
+ * check_fill_row:
+ * @rand: Random source
+ * @row: Row of @n BGRA pixels to fill
+ * @n: Number of pixels
+ *
+ * Fills a row the way CEF paints look: mostly premultiplied pixels with
+ * runs of opaque and fully transparent ones, plus a few pixels whose
+ * color exceeds their alpha to cover clamping.
+ */
+static void check_fill_row(GRand *rand, guint8 *row, gint n) {
+    gint kind = 0, left = 0;
+
+    for (gint i = 0; i < n; i++, row += FRAME_BYTES_PER_PIXEL) {
+        if (left-- <= 0) {
+            kind = g_rand_int_range(rand, 0, 4);
+            left = g_rand_int_range(rand, 1, 24);
+        }
+
+        guint8 a = kind == 0 ? 255 : kind == 1 ? 0 : (guint8)g_rand_int_range(rand, 0, 256);
+        for (gint c = 0; c < 3; c++) {
+            gint limit = kind == 3 ? 256 : a + 1;
+            row[c] = (guint8)g_rand_int_range(rand, 0, limit);
+        }
+        row[3] = a;
+    }
+}
+
+/**
+ * check_report:
+ * @kernel: Name of the kernel
+ * @simd: Output of the SIMD kernel
+ * @ref: Output of the C kernel
+ * @size: Bytes to compare
+ * @n: Width of the row in pixels
+ *
+ * Returns: TRUE if both outputs are equal, otherwise prints the first
+ *          difference and returns FALSE
+ */
+static gboolean check_report(const gchar *kernel, const guint8 *simd, const guint8 *ref,
+                             gsize size, gint n) {
+    for (gsize i = 0; i < size; i++) {
+        if (simd[i] != ref[i]) {
+            fprintf(stderr, "%s (%s): width %d, byte %" G_GSIZE_FORMAT ": got %u, expected %u\n",
+                    kernel, frame_convert_backend(), n, i, simd[i], ref[i]);
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+/**
+ * check_width:
+ * @rand: Random source
+ * @kernels: SIMD kernels to check
+ * @matrix: Conversion coefficients
+ * @n: Row width in pixels
+ *
+ * Runs every kernel and its C reference on random rows of @n pixels.
+ *
+ * Returns: TRUE if all outputs match
+ */
+static gboolean check_width(GRand *rand, const FrameKernels *kernels,
+                            const FrameYuvMatrix *matrix, gint n) {
+    const gsize bytes = (gsize)n * FRAME_BYTES_PER_PIXEL;
+    const gint chroma = (n + 1) / 2;
+    guint8 *row0 = g_new(guint8, bytes);
+    guint8 *row1 = g_new(guint8, bytes);
+    guint8 *simd = g_new0(guint8, bytes);
+    guint8 *ref = g_new0(guint8, bytes);
+    gboolean ok = TRUE;
+
+    for (gint r = 0; r < CHECK_ROWS_PER_WIDTH && ok; r++) {
+        check_fill_row(rand, row0, n);
+        check_fill_row(rand, row1, n);
+
+        kernels->unpremultiply_row(simd, row0, n);
+        frame_unpremultiply_row_c(ref, row0, n);
+        ok = check_report("unpremultiply_row", simd, ref, bytes, n);
+
+        if (ok) {
+            kernels->y_row(simd, row0, n, matrix);
+            frame_y_row_c(ref, row0, n, matrix);
+            ok = check_report("y_row", simd, ref, n, n);
+        }
+
+        // I420 and NV12 chroma layouts, from two rows and from a last
+        // row on its own
+        for (gint step = 1; step <= 2 && ok; step++) {
+            for (gint pair = 0; pair < 2 && ok; pair++) {
+                const guint8 *lower = pair ? row1 : row0;
+                const gsize size = (gsize)chroma * 2;
+                const gint v = step == 1 ? chroma : 1;
+
+                memset(simd, 0, size);
+                memset(ref, 0, size);
+                kernels->uv_row(simd, simd + v, step, row0, lower, n, matrix);
+                frame_uv_row_c(ref, ref + v, step, row0, lower, n, matrix);
+                ok = check_report(step == 1 ? "uv_row (planar)" : "uv_row (interleaved)",
+                                  simd, ref, size, n);
+            }
+        }
+    }
+
+    g_free(row0);
+    g_free(row1);
+    g_free(simd);
+    g_free(ref);
+    return ok;
+}
+
+int main(int argc, char *argv[]) {
+    const FrameKernels *kernels = frame_get_kernels();
+    guint32 seed = argc > 1 ? (guint32)strtoul(argv[1], NULL, 10) : 1;
+    struct {
+        gdouble kr, kb;
+        gboolean full_range;
+    } matrices[] = {
+        { 0.299, 0.114, FALSE },   // BT.601 limited
+        { 0.2126, 0.0722, TRUE },  // BT.709 full
+        { 0.2627, 0.0593, FALSE }, // BT.2020 limited
+    };
+    GRand *rand;
+    gboolean ok = TRUE;
+    guint cases = 0;
+
+    if (kernels->y_row == frame_y_row_c) {
+        fprintf(stderr, "frame kernels: no SIMD kernels on this CPU, nothing to check\n");
+        return 0;
+    }
+
+    rand = g_rand_new_with_seed(seed);
+    for (gsize m = 0; m < G_N_ELEMENTS(matrices) && ok; m++) {
+        FrameYuvMatrix matrix;
+        frame_yuv_matrix_init(&matrix, matrices[m].kr, matrices[m].kb, matrices[m].full_range);
+
+        for (gint n = 1; n <= 67 && ok; n++, cases++) {
+            ok = check_width(rand, kernels, &matrix, n);
+        }
+        for (gsize w = 0; w < G_N_ELEMENTS(check_widths) && ok; w++, cases++) {
+            ok = check_width(rand, kernels, &matrix, check_widths[w]);
+        }
+    }
+    g_rand_free(rand);
+
+    if (!ok) {
+        fprintf(stderr, "frame kernels: %s differs from c (seed %u)\n",
+                frame_convert_backend(), seed);
+        return 1;
+    }
+
+    fprintf(stderr, "frame kernels: %s matches c in %u widths (seed %u)\n",
+           frame_convert_backend(), cases, seed);
+    return 0;
+}
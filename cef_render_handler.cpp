@@ -1,5 +1,7 @@
 #include "cef_render_handler.h"
+#include "chromium_tracer.h"
 #include "debug_utils.h"
+#include "frame_utils.h"
 #include "gpu_utils.h"
 #include "gstchromiumsrc.h"
 
@@ -7,85 +9,165 @@
 #include <include/cef_browser.h>
 #include <include/cef_client.h>
 #include <include/cef_command_line.h>
+#include <include/cef_devtools_message_observer.h>
+#include <include/cef_registration.h>
+#include <include/cef_task.h>
 #include <include/wrapper/cef_helpers.h>
 
 #include <glib.h>
 #include <unistd.h>
 #include <vector>
 
+/* Process-wide CEF state: CEF is initialized once per process and its
+ * command line (and therefore the GPU mode) is shared by all browsers */
 static GMutex cef_init_mutex;
 static gboolean cef_initialized = FALSE;
 static GpuConfig* gpu_config = NULL;
-static guint cef_idle_id = 0;
-static int cef_message_count = 0;
 
-static gboolean cef_message_loop_idle(gpointer data);
+/* Dedicated CEF UI thread servicing every browser in the process. CEF
+ * work is run when Chromium asks for it via OnScheduleMessagePumpWork,
+ * and at least every CEF_PUMP_MAX_DELAY_MS in case a request was missed */
+static GMutex cef_pump_mutex;
+static GThread* cef_pump_thread = NULL;
+static GMainContext* cef_pump_context = NULL;
+static GSource* cef_pump_work_source = NULL;
+static gint64 cef_pump_work_deadline = 0;
+
+#define CEF_PUMP_MAX_DELAY_MS (1000 / 30)
+
+static void cef_pump_schedule_work(gint64 delay_ms);
+
+/* Paints whose damage is remembered for recycling buffers */
+#define CEF_DAMAGE_HISTORY 8
 
 /**
- * gpu_ensure_config:
- * @src: The GstChromiumSrc instance
+ * FrameTag - Content marker attached to output buffers
  *
- * Ensures GPU configuration is initialized exactly once. Determines whether
- * to enable GPU acceleration based on user specification and system availability.
+ * Records which render handler last painted a buffer and the paint
+ * sequence number it holds, so a recycled buffer only needs the
+ * damage of the paints it missed.
+ */
+typedef struct {
+    guint owner;
+    guint64 seq;
+} FrameTag;
+
+G_DEFINE_QUARK(chromiumsrc-frame-tag, frame_tag)
+
+static gint frame_tag_owner_count = 0;
+
+/**
+ * gpu_decide_config:
+ * @user_specified: Whether GPU mode was chosen explicitly
+ * @enabled: The chosen mode, if @user_specified
  *
- * Decision logic:
- * - If user explicitly enabled GPU and GPU is available: enable GPU
- * - If user explicitly disabled GPU: disable GPU
- * - If user didn't specify (auto): enable GPU if available
+ * Creates the process-wide GPU configuration. Must be called with
+ * cef_init_mutex held and before CEF is initialized.
  */
-static void gpu_ensure_config(GstChromiumSrc* src)
+static void gpu_decide_config(gboolean user_specified, gboolean enabled)
 {
-    if (gpu_config)
-    {
-        DEBUG_LOG_GL("ensure_config - Config already exists, skipping");
-        return;
-    }
-
     gpu_config = gpu_config_new();
 
-    if (src->gpu_user_specified)
+    if (user_specified)
     {
-        if (src->gpu_enabled && gpu_is_available())
+        if (enabled && gpu_is_available())
         {
             gpu_config_detect(gpu_config);
-            src->gpu_device = gpu_config->device_index;
         }
         else
         {
             gpu_config->enabled = FALSE;
-            src->gpu_enabled = FALSE;
         }
     }
-    else
+    else if (gpu_is_available())
     {
-        if (gpu_is_available())
-        {
-            gpu_config_detect(gpu_config);
-            src->gpu_enabled = gpu_config->enabled;
-            src->gpu_device = gpu_config->device_index;
-        }
+        gpu_config_detect(gpu_config);
     }
     DEBUG_LOG_GL("ensure_config - Final config: enabled=%d, device=%s",
-                 src->gpu_enabled, gpu_config->device_path ? gpu_config->device_path : "none");
+                 gpu_config->enabled, gpu_config->device_path ? gpu_config->device_path : "none");
+}
+
+/**
+ * gpu_ensure_config:
+ * @src: The GstChromiumSrc instance
+ *
+ * Ensures GPU configuration is initialized exactly once per process, since
+ * CEF's GPU mode is fixed by the command line at initialization. Determines
+ * whether to enable GPU acceleration based on the first instance's
+ * specification and system availability, then reports the shared result
+ * back on @src.
+ *
+ * Decision logic:
+ * - If user explicitly enabled GPU and GPU is available: enable GPU
+ * - If user explicitly disabled GPU: disable GPU
+ * - If user didn't specify (auto): enable GPU if available
+ */
+static void gpu_ensure_config(GstChromiumSrc* src)
+{
+    g_mutex_lock(&cef_init_mutex);
+
+    if (!gpu_config)
+    {
+        gpu_decide_config(src->gpu_user_specified, src->gpu_enabled);
+    }
+    else if (src->gpu_user_specified && src->gpu_enabled != gpu_config->enabled)
+    {
+        DEBUG_LOG_GL("ensure_config - Requested gpu=%s, but CEF already runs with gpu=%s",
+                     src->gpu_enabled ? "true" : "false", gpu_config->enabled ? "true" : "false");
+    }
+
+    src->gpu_enabled = gpu_config->enabled;
+    src->gpu_device = gpu_config->enabled ? gpu_config->device_index : -1;
+
+    g_mutex_unlock(&cef_init_mutex);
 
     // Log GL environment details
     //debug_log_gl_info();
 }
 
+/**
+ * cef_browser_current:
+ * @src: The GstChromiumSrc instance
+ * @generation: Browser generation a handler or task was created for
+ *
+ * Tells whether a browser's callbacks and tasks may still change the
+ * element's state. CloseBrowser() is asynchronous, so a browser closed
+ * by cef_browser_stop() keeps delivering paints and events for a while,
+ * and tasks posted for it may run after a new browser was started.
+ * Must be called with frame_mutex held.
+ *
+ * Returns: TRUE if @generation is the running browser's
+ */
+static gboolean cef_browser_current(GstChromiumSrc* src, gint generation)
+{
+    return src->running && src->browser_generation == generation;
+}
+
 /**
  * CefRenderHandlerImpl - Handles offscreen rendering for CEF browser
  *
  * Provides the view rectangle dimensions and receives painted pixel data
- * from CEF's offscreen rendering pipeline.
+ * from CEF's offscreen rendering pipeline. The view size is the element's
+ * view_width/view_height, changed by cef_browser_resize(). Holds a
+ * reference on the element until CEF released it.
  */
 class CefRenderHandlerImpl : public CefRenderHandler
 {
 public:
-    CefRenderHandlerImpl(GstChromiumSrc* src, int width, int height)
-        : src_(src), width_(width), height_(height)
+    CefRenderHandlerImpl(GstChromiumSrc* src, gint generation, int width, int height)
+        : src_(static_cast<GstChromiumSrc*>(gst_object_ref(src))),
+          generation_(generation),
+          width_(width),
+          height_(height),
+          owner_id_(NewOwnerId())
     {
     }
 
+    ~CefRenderHandlerImpl() override
+    {
+        gst_object_unref(src_);
+    }
+
     /**
      * GetViewRect:
      * @browser: The CEF browser instance
@@ -96,11 +178,13 @@ public:
      * allocate for rendering.
      *
      * Invoked by CEF when it needs to know the view dimensions,
-     * typically during browser creation and resize operations.
+     * typically during browser creation and after WasResized().
      */
     void GetViewRect(CefRefPtr<CefBrowser> browser, CefRect& rect) override
     {
-        rect.Set(0, 0, width_, height_);
+        g_mutex_lock(&src_->frame_mutex);
+        rect.Set(0, 0, src_->view_width, src_->view_height);
+        g_mutex_unlock(&src_->frame_mutex);
     }
 
     /**
@@ -112,10 +196,18 @@ public:
      * @width: Width of the buffer in pixels
      * @height: Height of the buffer in pixels
      *
-     * Receives rendered pixel data from CEF and copies it to the
-     * GStreamer element's frame buffer. Signals the frame_ready
-     * condition to notify the need_data callback that a new frame
-     * is available.
+     * Receives rendered pixel data from CEF and copies it once into a
+     * buffer from the element's pool, converting to I420 or NV12 in the
+     * same pass when that was negotiated. A frame that has not been pushed
+     * yet is overwritten in place, otherwise a fresh buffer is acquired
+     * without blocking. With dirty-rects enabled only the regions
+     * repainted since the buffer was last filled are copied. Records
+     * when the pixels arrived next to the begin frame that produced them
+     * and signals frame_cond so create() can push the buffer as-is.
+     * Paints during a runtime navigation are dropped, and the first one
+     * after it is announced with a chromiumsrc-navigated message. Paints
+     * not matching the view size or the negotiated caps, as happens
+     * around a resize, are dropped as size mismatches.
      *
      * Invoked by CEF after rendering a frame to the offscreen buffer.
      * Called on the CEF UI thread when page content changes.
@@ -127,34 +219,292 @@ public:
                  int width,
                  int height) override
     {
-        static int paint_count = 0;
-        paint_count++;
-
-        if (!src_ || !src_->running || !src_->frame_buffer)
+        g_mutex_lock(&src_->frame_mutex);
+        gboolean current = cef_browser_current(src_, generation_);
+        g_mutex_unlock(&src_->frame_mutex);
+        if (!current)
         {
             return;
         }
 
-        if (width != width_ || height != height_)
+        GstClockTime painted = gst_util_get_timestamp();
+
+        if (!RecordPaint(painted, width, height))
         {
             DEBUG_LOG("OnPaint - Size mismatch: got %dx%d, expected %dx%d",
                       width, height, width_, height_);
             return;
         }
 
+        RecordDamage(dirtyRects);
+
+        // Step 1: Take the unpushed frame back, or a free pooled buffer
         g_mutex_lock(&src_->frame_mutex);
+        if (!cef_browser_current(src_, generation_) || !src_->pool || src_->navigating ||
+            !src_->page_ready)
+        {
+            // While navigating create() keeps repeating the last frame,
+            // before the page is ready it outputs nothing at all
+            g_mutex_unlock(&src_->frame_mutex);
+            return;
+        }
+        if (src_->frame_done_pending || (src_->frame_sync && !src_->capture_paint))
+        {
+            // With frame-sync only the paint after frameDone() is output
+            g_mutex_unlock(&src_->frame_mutex);
+            return;
+        }
+        src_->capture_paint = FALSE;
+        GstBufferPool* pool = static_cast<GstBufferPool*>(gst_object_ref(src_->pool));
+        GstBuffer* frame = src_->pending_buffer;
+        src_->pending_buffer = NULL;
+        if (frame)
+        {
+            // Replaced before an output slot took it
+            src_->frames_dropped++;
+        }
+        gboolean dirty_rects = src_->dirty_rects;
+        GstVideoInfo info = src_->info;
+        FrameFormat format = src_->frame_format;
+        FrameYuvMatrix matrix = src_->yuv_matrix;
+        g_mutex_unlock(&src_->frame_mutex);
+
+        if (!frame)
+        {
+            GstBufferPoolAcquireParams params = {};
+            params.flags = GST_BUFFER_POOL_ACQUIRE_FLAG_DONTWAIT;
+            if (gst_buffer_pool_acquire_buffer(pool, &frame, &params) != GST_FLOW_OK)
+            {
+                DEBUG_LOG("OnPaint - No free pooled buffer, dropping paint");
+                gst_object_unref(pool);
+                return;
+            }
+        }
+        gst_object_unref(pool);
 
-        memcpy(src_->frame_buffer, buffer, src_->frame_size);
-        src_->frame_ready = TRUE;
-        g_cond_signal(&src_->frame_cond);
+        // Step 2: Work out what the buffer is missing
+        std::vector<FrameRect> rects;
+        if (!dirty_rects || !CollectDamage(frame, rects))
+        {
+            rects.assign(1, FrameRect{0, 0, width, height});
+        }
+
+        // Step 3: Single pass from the CEF buffer into the pooled buffer,
+        // converting to the negotiated format on the way
+        GstVideoFrame vframe;
+        if (!gst_video_frame_map(&vframe, &info, frame, GST_MAP_WRITE))
+        {
+            DEBUG_LOG("OnPaint - Failed to map pooled buffer");
+            gst_buffer_unref(frame);
+            return;
+        }
+
+        FramePlanes planes = {};
+        for (guint i = 0; i < GST_VIDEO_FRAME_N_PLANES(&vframe) && i < G_N_ELEMENTS(planes.data); i++)
+        {
+            planes.data[i] = static_cast<guint8*>(GST_VIDEO_FRAME_PLANE_DATA(&vframe, i));
+            planes.stride[i] = GST_VIDEO_FRAME_PLANE_STRIDE(&vframe, i);
+        }
+
+        const guint8* in = static_cast<const guint8*>(buffer);
+        gsize copied = 0;
+
+        for (const FrameRect& rect : rects)
+        {
+            copied += frame_write_rect(format, &planes, in, width * 4, &rect,
+                                       width, height, &matrix);
+        }
+        gst_video_frame_unmap(&vframe);
+        TagFrame(frame);
+        if (chromium_tracer_enabled())
+        {
+            chromium_tracer_record(GST_ELEMENT(src_), CHROMIUM_TRACER_PAINT, painted,
+                                   gst_util_get_timestamp());
+        }
 
+        // Step 4: Hand the buffer to create()
+        g_mutex_lock(&src_->frame_mutex);
+        src_->paint_count++;
+        src_->bytes_copied += copied;
+        if (cef_browser_current(src_, generation_))
+        {
+            src_->pending_buffer = frame;
+            src_->pending_begin_time = src_->begin_frame_time;
+            src_->pending_paint_time = painted;
+            frame = NULL;
+            g_cond_signal(&src_->frame_cond);
+        }
+        // The next navigation replaces the URL, so take a copy under the lock
+        gchar* announce_url = src_->announce_navigation ? g_strdup(src_->navigation_url) : NULL;
+        gint announce_status = src_->navigation_status;
+        gboolean announce = src_->announce_navigation;
+        src_->announce_navigation = FALSE;
         g_mutex_unlock(&src_->frame_mutex);
+
+        if (announce)
+        {
+            gst_element_post_message(GST_ELEMENT(src_),
+                gst_message_new_element(GST_OBJECT(src_),
+                    gst_structure_new(GST_CHROMIUM_SRC_NAVIGATED_MESSAGE,
+                        "url", G_TYPE_STRING, announce_url,
+                        "http-status", G_TYPE_INT, announce_status,
+                        NULL)));
+        }
+        g_free(announce_url);
+
+        if (frame)
+        {
+            gst_buffer_unref(frame);
+        }
     }
 
 private:
+    /**
+     * NewOwnerId:
+     *
+     * Returns: A process-unique id for tagging frames
+     */
+    static guint NewOwnerId()
+    {
+        return (guint)g_atomic_int_add(&frame_tag_owner_count, 1) + 1;
+    }
+
+    /**
+     * RecordPaint:
+     * @painted: When the paint was received
+     * @width: Width of the paint
+     * @height: Height of the paint
+     *
+     * Updates the paint counters and interval statistics reported by
+     * the element's stats property, and checks the paint against the
+     * current view size and the negotiated caps. When the view was
+     * resized the damage history is dropped and frames painted at the
+     * old size are no longer recognized as ours.
+     *
+     * Returns: TRUE if the paint can be copied into an output buffer
+     */
+    gboolean RecordPaint(GstClockTime painted, int width, int height)
+    {
+        g_mutex_lock(&src_->frame_mutex);
+        if (src_->view_width != width_ || src_->view_height != height_)
+        {
+            width_ = src_->view_width;
+            height_ = src_->view_height;
+            owner_id_ = NewOwnerId();
+            paint_seq_ = 0;
+        }
+        gboolean mismatch = width != width_ || height != height_ ||
+            (GST_VIDEO_INFO_WIDTH(&src_->info) > 0 &&
+             (GST_VIDEO_INFO_WIDTH(&src_->info) != width ||
+              GST_VIDEO_INFO_HEIGHT(&src_->info) != height));
+        src_->paints_received++;
+        if (mismatch)
+        {
+            src_->size_mismatches++;
+        }
+        if (GST_CLOCK_TIME_IS_VALID(src_->last_paint_time) && painted > src_->last_paint_time)
+        {
+            GstClockTime interval = painted - src_->last_paint_time;
+            src_->paint_interval_min = MIN(src_->paint_interval_min, interval);
+            src_->paint_interval_max = MAX(src_->paint_interval_max, interval);
+            src_->paint_interval_sum += interval;
+            src_->paint_intervals++;
+        }
+        src_->last_paint_time = painted;
+        g_mutex_unlock(&src_->frame_mutex);
+
+        return !mismatch;
+    }
+
+    /**
+     * RecordDamage:
+     * @dirtyRects: The rectangles CEF repainted in this paint
+     *
+     * Starts a new paint sequence number and remembers its clipped
+     * damage in the history ring.
+     */
+    void RecordDamage(const RectList& dirtyRects)
+    {
+        paint_seq_++;
+
+        std::vector<FrameRect>& damage = damage_[paint_seq_ % CEF_DAMAGE_HISTORY];
+        damage.clear();
+        for (const CefRect& dirty : dirtyRects)
+        {
+            FrameRect rect = {dirty.x, dirty.y, dirty.width, dirty.height};
+            if (frame_rect_clip(&rect, width_, height_))
+            {
+                damage.push_back(rect);
+            }
+        }
+    }
+
+    /**
+     * CollectDamage:
+     * @frame: The buffer about to be painted into
+     * @rects: Output list of rectangles the buffer is missing
+     *
+     * Gathers the damage of all paints since @frame was last filled by
+     * this handler. Fails when the buffer's content is unknown or too
+     * old for the history, when the damage adds up to a full frame, or
+     * when its memory is still shared, e.g. with a repeat of the frame.
+     *
+     * Returns: TRUE if @rects is enough to bring @frame up to date
+     */
+    bool CollectDamage(GstBuffer* frame, std::vector<FrameRect>& rects)
+    {
+        const FrameTag* tag = static_cast<const FrameTag*>(
+            gst_mini_object_get_qdata(GST_MINI_OBJECT_CAST(frame), frame_tag_quark()));
+
+        if (!tag || tag->owner != owner_id_ || tag->seq == 0 ||
+            paint_seq_ - tag->seq >= CEF_DAMAGE_HISTORY ||
+            !gst_buffer_is_all_memory_writable(frame))
+        {
+            return false;
+        }
+
+        const gint64 full_area = (gint64)width_ * height_;
+        gint64 area = 0;
+        for (guint64 seq = tag->seq + 1; seq <= paint_seq_; seq++)
+        {
+            for (const FrameRect& rect : damage_[seq % CEF_DAMAGE_HISTORY])
+            {
+                area += (gint64)rect.width * rect.height;
+                rects.push_back(rect);
+            }
+        }
+
+        return area < full_area;
+    }
+
+    /**
+     * TagFrame:
+     * @frame: The buffer that now holds the current paint
+     *
+     * Marks @frame as holding this handler's latest paint. The tag
+     * travels with the buffer through the pool.
+     */
+    void TagFrame(GstBuffer* frame)
+    {
+        GstMiniObject* object = GST_MINI_OBJECT_CAST(frame);
+        FrameTag* tag = static_cast<FrameTag*>(gst_mini_object_get_qdata(object, frame_tag_quark()));
+
+        if (!tag)
+        {
+            tag = g_new0(FrameTag, 1);
+            gst_mini_object_set_qdata(object, frame_tag_quark(), tag, g_free);
+        }
+        tag->owner = owner_id_;
+        tag->seq = paint_seq_;
+    }
+
     GstChromiumSrc* src_;
+    gint generation_;
     int width_;
     int height_;
+    guint owner_id_;
+    guint64 paint_seq_ = 0;
+    std::vector<FrameRect> damage_[CEF_DAMAGE_HISTORY];
 
     IMPLEMENT_REFCOUNTING(CefRenderHandlerImpl);
 };
@@ -163,12 +513,20 @@ private:
  * CefLoadHandlerImpl - Handles page load events from CEF browser
  *
  * Monitors page loading progress and reports errors during navigation.
+ * Holds a reference on the element until CEF released it.
  */
 class CefLoadHandlerImpl : public CefLoadHandler
 {
 public:
-    CefLoadHandlerImpl(GstChromiumSrc* src) : src_(src)
+    CefLoadHandlerImpl(GstChromiumSrc* src, gint generation)
+        : src_(static_cast<GstChromiumSrc*>(gst_object_ref(src))),
+          generation_(generation)
+    {
+    }
+
+    ~CefLoadHandlerImpl() override
     {
+        gst_object_unref(src_);
     }
 
     /**
@@ -178,8 +536,11 @@ public:
      * @httpStatusCode: HTTP status code of the response
      *
      * Marks the page as loaded when the main frame finishes loading.
-     * This signals the message loop thread to start requesting paint
-     * invalidations for continuous frame updates.
+     * From then on every begin frame also invalidates the view, so each
+     * output slot gets a fresh paint. Ends a runtime navigation: paints
+     * are accepted again and one repaint is forced, as Chromium may
+     * already have painted the new page while paints were dropped.
+     * With ready-mode=load this also releases the first frame.
      *
      * Invoked by CEF when a frame completes loading, regardless of
      * success or failure.
@@ -191,7 +552,28 @@ public:
         if (frame->IsMain())
         {
             DEBUG_LOG_CEF("Page loaded (HTTP %d)", httpStatusCode);
+
+            g_mutex_lock(&src_->frame_mutex);
+            if (!cef_browser_current(src_, generation_))
+            {
+                g_mutex_unlock(&src_->frame_mutex);
+                return;
+            }
             src_->page_loaded = TRUE;
+            if (src_->navigating)
+            {
+                src_->navigating = FALSE;
+                src_->repaint = TRUE;
+                src_->announce_navigation = TRUE;
+                src_->navigation_status = httpStatusCode;
+            }
+            if (!src_->page_ready && src_->ready_mode == GST_CHROMIUM_SRC_READY_LOAD)
+            {
+                src_->page_ready = TRUE;
+                src_->repaint = TRUE;
+                g_cond_broadcast(&src_->frame_cond);
+            }
+            g_mutex_unlock(&src_->frame_mutex);
         }
     }
 
@@ -224,19 +606,103 @@ public:
 
 private:
     GstChromiumSrc* src_;
+    gint generation_;
     IMPLEMENT_REFCOUNTING(CefLoadHandlerImpl);
 };
 
+/**
+ * CefVirtualTimeObserver - Turns expired virtual time budgets into frames
+ *
+ * Registered on browsers of non-live elements. Each budget granted by
+ * cef_browser_advance_time() ends in a begin frame, so animations render
+ * at the new virtual time. Holds a reference on the element until CEF
+ * released it.
+ */
+class CefVirtualTimeObserver : public CefDevToolsMessageObserver
+{
+public:
+    CefVirtualTimeObserver(GstChromiumSrc* src, gint generation)
+        : src_(static_cast<GstChromiumSrc*>(gst_object_ref(src))),
+          generation_(generation)
+    {
+    }
+
+    ~CefVirtualTimeObserver() override
+    {
+        gst_object_unref(src_);
+    }
+
+    /**
+     * OnDevToolsEvent:
+     * @browser: The CEF browser instance
+     * @method: The DevTools event name
+     * @params: JSON parameters of the event
+     * @params_size: Size of @params
+     *
+     * On Emulation.virtualTimeBudgetExpired requests the begin frame for
+     * the new virtual time, and lets the element grant the next budget.
+     * Budgets never overlap, so expiries arrive in the order they were
+     * granted and are counted to tell which budget ended. Only the end
+     * of the budget of the buffer being produced makes its paint the
+     * output frame without frame-sync, and lets frameDone() capture
+     * with it. Events of a closed browser are ignored.
+     *
+     * Invoked by CEF on the UI thread for every DevTools event.
+     */
+    void OnDevToolsEvent(CefRefPtr<CefBrowser> browser,
+                         const CefString& method,
+                         const void* params,
+                         size_t params_size) override
+    {
+        if (method != "Emulation.virtualTimeBudgetExpired")
+        {
+            return;
+        }
+
+        g_mutex_lock(&src_->frame_mutex);
+        if (!cef_browser_current(src_, generation_))
+        {
+            g_mutex_unlock(&src_->frame_mutex);
+            return;
+        }
+        src_->budget_expired++;
+        g_cond_broadcast(&src_->frame_cond);
+        if (src_->budget_expired == src_->budget_frame && src_->frame_done_pending &&
+            !src_->frame_sync)
+        {
+            src_->frame_done_pending = FALSE;
+            src_->capture_paint = TRUE;
+            src_->repaint = TRUE;
+        }
+        g_mutex_unlock(&src_->frame_mutex);
+
+        cef_browser_request_frame(src_);
+    }
+
+private:
+    GstChromiumSrc* src_;
+    gint generation_;
+    IMPLEMENT_REFCOUNTING(CefVirtualTimeObserver);
+};
+
 /**
  * CefLifeSpanHandlerImpl - Handles browser lifecycle events
  *
- * Receives callbacks when a browser is created or closed.
+ * Receives callbacks when a browser is created or closed. Holds a
+ * reference on the element until CEF released it.
  */
 class CefLifeSpanHandlerImpl : public CefLifeSpanHandler
 {
 public:
-    CefLifeSpanHandlerImpl(GstChromiumSrc* src) : src_(src)
+    CefLifeSpanHandlerImpl(GstChromiumSrc* src, gint generation)
+        : src_(static_cast<GstChromiumSrc*>(gst_object_ref(src))),
+          generation_(generation)
+    {
+    }
+
+    ~CefLifeSpanHandlerImpl() override
     {
+        gst_object_unref(src_);
     }
 
     /**
@@ -244,7 +710,11 @@ public:
      * @browser: The newly created CEF browser instance
      *
      * Stores the browser reference after it's created. This is the
-     * callback for the asynchronous CreateBrowser call.
+     * callback for the asynchronous CreateBrowser call. A browser that
+     * is no longer the element's current one, because it was stopped or
+     * replaced before creation completed, is closed instead. For non-live
+     * elements virtual time is paused right away, so the page only
+     * advances by the budgets cef_browser_advance_time() grants.
      *
      * Invoked by CEF after the browser has been created successfully.
      */
@@ -252,20 +722,52 @@ public:
     {
         DEBUG_LOG_CEF("OnAfterCreated called - browser=%p, src_=%p", browser.get(), src_);
         CEF_REQUIRE_UI_THREAD();
-        if (src_)
+        g_mutex_lock(&src_->frame_mutex);
+        gboolean current = cef_browser_current(src_, generation_);
+        g_mutex_unlock(&src_->frame_mutex);
+
+        if (!current)
         {
-            src_->cef_browser = static_cast<gpointer>(browser.get());
-            browser->AddRef();
-            DEBUG_LOG_CEF("OnAfterCreated - Browser stored successfully");
+            DEBUG_LOG_CEF("OnAfterCreated - Browser is stale, closing it");
+            browser->GetHost()->CloseBrowser(TRUE);
+            return;
         }
-        else
+
+        src_->cef_browser = static_cast<gpointer>(browser.get());
+        browser->AddRef();
+        DEBUG_LOG_CEF("OnAfterCreated - Browser stored successfully");
+
+        if (!gst_base_src_is_live(GST_BASE_SRC(src_)))
         {
-            DEBUG_LOG_CEF("OnAfterCreated - WARNING: src_ is NULL!");
+            devtools_registration_ = browser->GetHost()->AddDevToolsMessageObserver(
+                new CefVirtualTimeObserver(src_, generation_));
+
+            CefRefPtr<CefDictionaryValue> params = CefDictionaryValue::Create();
+            params->SetString("policy", "pause");
+            browser->GetHost()->ExecuteDevToolsMethod(0, "Emulation.setVirtualTimePolicy", params);
+            DEBUG_LOG_CEF("OnAfterCreated - Virtual time paused");
         }
     }
 
+    /**
+     * OnBeforeClose:
+     * @browser: The CEF browser instance
+     *
+     * Unregisters the virtual time observer, releasing its reference on
+     * the element as soon as the browser is gone.
+     *
+     * Invoked by CEF on the UI thread right before the browser is
+     * destroyed.
+     */
+    void OnBeforeClose(CefRefPtr<CefBrowser> browser) override
+    {
+        devtools_registration_ = nullptr;
+    }
+
 private:
     GstChromiumSrc* src_;
+    gint generation_;
+    CefRefPtr<CefRegistration> devtools_registration_;
     IMPLEMENT_REFCOUNTING(CefLifeSpanHandlerImpl);
 };
 
@@ -273,148 +775,634 @@ private:
  * CefClientImpl - Main CEF client interface implementation
  *
  * Provides access to the render, load, and lifespan handlers. This is the main
- * interface CEF uses to communicate with the application.
+ * interface CEF uses to communicate with the application. Holds a reference
+ * on the element until CEF released it.
+ */
+class CefClientImpl : public CefClient
+{
+public:
+    CefClientImpl(GstChromiumSrc* src,
+                  gint generation,
+                  CefRefPtr<CefRenderHandler> render_handler,
+                  CefRefPtr<CefLoadHandler> load_handler,
+                  CefRefPtr<CefLifeSpanHandler> lifespan_handler)
+        : src_(static_cast<GstChromiumSrc*>(gst_object_ref(src))),
+          generation_(generation),
+          render_handler_(render_handler),
+          load_handler_(load_handler),
+          lifespan_handler_(lifespan_handler)
+    {
+    }
+
+    ~CefClientImpl() override
+    {
+        gst_object_unref(src_);
+    }
+
+    /**
+     * GetRenderHandler:
+     *
+     * Returns the render handler for offscreen rendering.
+     *
+     * Invoked by CEF when it needs to perform offscreen rendering
+     * operations.
+     */
+    CefRefPtr<CefRenderHandler> GetRenderHandler() override
+    {
+        return render_handler_;
+    }
+
+    /**
+     * GetLoadHandler:
+     *
+     * Returns the load handler for monitoring page load events.
+     *
+     * Invoked by CEF when a navigation begins or ends.
+     */
+    CefRefPtr<CefLoadHandler> GetLoadHandler() override
+    {
+        return load_handler_;
+    }
+
+    /**
+     * GetLifeSpanHandler:
+     *
+     * Returns the lifespan handler for browser creation callbacks.
+     *
+     * Invoked by CEF during browser creation and destruction.
+     */
+    CefRefPtr<CefLifeSpanHandler> GetLifeSpanHandler() override
+    {
+        return lifespan_handler_;
+    }
+
+    /**
+     * OnProcessMessageReceived:
+     * @browser: The CEF browser instance
+     * @frame: The frame the message came from
+     * @source_process: The process that sent the message
+     * @message: The message
+     *
+     * Releases the first frame with ready-mode=signal once the page
+     * called window.chromiumsrc.ready(), which the renderer process
+     * forwards as a GST_CHROMIUM_SRC_READY_MESSAGE. With frame-sync a
+     * GST_CHROMIUM_SRC_FRAME_DONE_MESSAGE from frameDone() means the
+     * page finished updating for the current frame; a repaint is
+     * requested and the paint it produces is captured. When not live
+     * it only counts once the buffer's virtual time budget expired.
+     *
+     * Invoked by CEF on the UI thread for messages from the renderer.
+     *
+     * Returns: true if the message was handled
+     */
+    bool OnProcessMessageReceived(CefRefPtr<CefBrowser> browser,
+                                  CefRefPtr<CefFrame> frame,
+                                  CefProcessId source_process,
+                                  CefRefPtr<CefProcessMessage> message) override
+    {
+        if (message->GetName() == GST_CHROMIUM_SRC_FRAME_DONE_MESSAGE)
+        {
+            // When not live only a frame finished on the buffer's own
+            // virtual time counts, not one of an earlier budget
+            g_mutex_lock(&src_->frame_mutex);
+            gboolean capture = cef_browser_current(src_, generation_) &&
+                src_->frame_done_pending &&
+                (gst_base_src_is_live(GST_BASE_SRC(src_)) ||
+                 (src_->budget_frame && src_->budget_expired == src_->budget_frame));
+            if (capture)
+            {
+                src_->frame_done_pending = FALSE;
+                src_->capture_paint = TRUE;
+                src_->repaint = TRUE;
+            }
+            g_mutex_unlock(&src_->frame_mutex);
+
+            if (capture)
+            {
+                cef_browser_request_frame(src_);
+            }
+            return true;
+        }
+
+        if (message->GetName() != GST_CHROMIUM_SRC_READY_MESSAGE)
+        {
+            return false;
+        }
+
+        DEBUG_LOG_CEF("Page signalled ready");
+        g_mutex_lock(&src_->frame_mutex);
+        if (cef_browser_current(src_, generation_) && !src_->page_ready &&
+            src_->ready_mode == GST_CHROMIUM_SRC_READY_SIGNAL)
+        {
+            src_->page_ready = TRUE;
+            src_->repaint = TRUE;
+            g_cond_broadcast(&src_->frame_cond);
+        }
+        g_mutex_unlock(&src_->frame_mutex);
+        return true;
+    }
+
+private:
+    GstChromiumSrc* src_;
+    gint generation_;
+    CefRefPtr<CefRenderHandler> render_handler_;
+    CefRefPtr<CefLoadHandler> load_handler_;
+    CefRefPtr<CefLifeSpanHandler> lifespan_handler_;
+
+    IMPLEMENT_REFCOUNTING(CefClientImpl);
+};
+
+/**
+ * CefBeginFrameTask - Drives one frame of the browser from the output rate
+ *
+ * Posted to the CEF UI thread once per output slot. The browser runs with
+ * external begin frames, so Chromium only renders when this task asks it
+ * to. Holds a reference on the element until it has run.
+ */
+class CefBeginFrameTask : public CefTask
+{
+public:
+    explicit CefBeginFrameTask(GstChromiumSrc* src)
+        : src_(static_cast<GstChromiumSrc*>(gst_object_ref(src))),
+          generation_(g_atomic_int_get(&src->browser_generation))
+    {
+    }
+
+    ~CefBeginFrameTask() override
+    {
+        gst_object_unref(src_);
+    }
+
+    /**
+     * Execute:
+     *
+     * Forces a repaint of the loaded page, unless the element's
+     * invalidate property is off, and issues the begin frame that makes
+     * Chromium produce it. Without the invalidation Chromium only paints
+     * when content changed, and create() repeats the previous frame;
+     * a finished navigation still invalidates once.
+     * The time of the begin frame is kept for the paint it results in.
+     *
+     * Invoked by CEF on the UI thread during message loop work.
+     */
+    void Execute() override
+    {
+        if (!src_->cef_browser)
+        {
+            return;
+        }
+
+        auto browser = static_cast<CefBrowser*>(src_->cef_browser);
+
+        g_mutex_lock(&src_->frame_mutex);
+        if (!cef_browser_current(src_, generation_))
+        {
+            g_mutex_unlock(&src_->frame_mutex);
+            return;
+        }
+        gboolean invalidate = src_->page_loaded && (src_->invalidate || src_->repaint);
+        if (invalidate)
+        {
+            src_->repaint = FALSE;
+        }
+        src_->begin_frame_time = gst_util_get_timestamp();
+        g_mutex_unlock(&src_->frame_mutex);
+
+        if (invalidate)
+        {
+            browser->GetHost()->Invalidate(PET_VIEW);
+        }
+        browser->GetHost()->SendExternalBeginFrame();
+    }
+
+private:
+    GstChromiumSrc* src_;
+    gint generation_;
+    IMPLEMENT_REFCOUNTING(CefBeginFrameTask);
+};
+
+/*
+ * Hands the page's animation timeline to the element: pauses every CSS
+ * and Web Animation and sets it to time t (ms), and makes
+ * requestAnimationFrame callbacks receive t. Animations that existed
+ * when the timeline was taken over keep their start on the document
+ * timeline, later ones start at the element time they are first seen.
+ */
+static const char* const timeline_script =
+    "(function (t) {"
+    "  var c = window.__chromiumsrcTimeline;"
+    "  if (!c) {"
+    "    c = window.__chromiumsrcTimeline = { time: t, first: true };"
+    "    var raf = window.requestAnimationFrame.bind(window);"
+    "    window.requestAnimationFrame = function (cb) {"
+    "      return raf(function () { cb(c.time); });"
+    "    };"
+    "  }"
+    "  c.time = t;"
+    "  document.getAnimations().forEach(function (a) {"
+    "    if (a.__chromiumsrcStart === undefined) {"
+    "      a.__chromiumsrcStart = c.first && a.startTime !== null ? a.startTime"
+    "                                                             : t - (a.currentTime || 0);"
+    "    }"
+    "    a.pause();"
+    "    a.currentTime = t - a.__chromiumsrcStart;"
+    "  });"
+    "  c.first = false;"
+    "})";
+
+/**
+ * CefVirtualTimeTask - Lets virtual time of a non-live page run on
+ *
+ * Posted to the CEF UI thread by cef_browser_advance_time(). Holds a
+ * reference on the element until it has run.
+ */
+class CefVirtualTimeTask : public CefTask
+{
+public:
+    CefVirtualTimeTask(GstChromiumSrc* src, double budget, GstClockTime timeline)
+        : src_(static_cast<GstChromiumSrc*>(gst_object_ref(src))),
+          generation_(g_atomic_int_get(&src->browser_generation)),
+          budget_(budget),
+          timeline_(timeline)
+    {
+    }
+
+    ~CefVirtualTimeTask() override
+    {
+        gst_object_unref(src_);
+    }
+
+    /**
+     * Execute:
+     *
+     * Grants the page a budget of virtual time in milliseconds. Time
+     * stands still while network fetches are pending, so slow loads do
+     * not change what a frame shows. When the element took over the
+     * timeline, the page's animations are first set to its time; both
+     * go through the same DevTools session, so the frame rendered when
+     * the budget expired shows them at that time. Retries shortly while
+     * the browser is still being created.
+     *
+     * Invoked by CEF on the UI thread during message loop work.
+     */
+    void Execute() override
+    {
+        g_mutex_lock(&src_->frame_mutex);
+        gboolean current = cef_browser_current(src_, generation_);
+        g_mutex_unlock(&src_->frame_mutex);
+        if (!current)
+        {
+            return;
+        }
+
+        if (!src_->cef_browser)
+        {
+            CefPostDelayedTask(TID_UI, this, 10);
+            return;
+        }
+
+        auto browser = static_cast<CefBrowser*>(src_->cef_browser);
+
+        if (GST_CLOCK_TIME_IS_VALID(timeline_))
+        {
+            gchar time[G_ASCII_DTOSTR_BUF_SIZE];
+            g_ascii_formatd(time, sizeof(time), "%.3f", (double)timeline_ / GST_MSECOND);
+            gchar* expression = g_strdup_printf("%s(%s)", timeline_script, time);
+
+            CefRefPtr<CefDictionaryValue> evaluate = CefDictionaryValue::Create();
+            evaluate->SetString("expression", expression);
+            browser->GetHost()->ExecuteDevToolsMethod(0, "Runtime.evaluate", evaluate);
+            g_free(expression);
+        }
+
+        CefRefPtr<CefDictionaryValue> params = CefDictionaryValue::Create();
+        params->SetString("policy", "pauseIfNetworkFetchesPending");
+        params->SetDouble("budget", budget_);
+        browser->GetHost()->ExecuteDevToolsMethod(0, "Emulation.setVirtualTimePolicy", params);
+    }
+
+private:
+    GstChromiumSrc* src_;
+    gint generation_;
+    double budget_;
+    GstClockTime timeline_;
+    IMPLEMENT_REFCOUNTING(CefVirtualTimeTask);
+};
+
+/**
+ * CefResizeTask - Tells a running browser its view size changed
+ *
+ * Posted to the CEF UI thread by cef_browser_resize(). Holds a reference
+ * on the element until it has run.
+ */
+class CefResizeTask : public CefTask
+{
+public:
+    explicit CefResizeTask(GstChromiumSrc* src)
+        : src_(static_cast<GstChromiumSrc*>(gst_object_ref(src))),
+          generation_(g_atomic_int_get(&src->browser_generation))
+    {
+    }
+
+    ~CefResizeTask() override
+    {
+        gst_object_unref(src_);
+    }
+
+    /**
+     * Execute:
+     *
+     * Makes Chromium query GetViewRect() again, relayout the page and
+     * repaint it at the new size. A browser still being created picks
+     * up the size when it asks for the view rect the first time.
+     *
+     * Invoked by CEF on the UI thread during message loop work.
+     */
+    void Execute() override
+    {
+        g_mutex_lock(&src_->frame_mutex);
+        gboolean current = cef_browser_current(src_, generation_);
+        g_mutex_unlock(&src_->frame_mutex);
+        if (!current || !src_->cef_browser)
+        {
+            return;
+        }
+
+        auto browser = static_cast<CefBrowser*>(src_->cef_browser);
+        browser->GetHost()->WasResized();
+        browser->GetHost()->Invalidate(PET_VIEW);
+    }
+
+private:
+    GstChromiumSrc* src_;
+    gint generation_;
+    IMPLEMENT_REFCOUNTING(CefResizeTask);
+};
+
+/**
+ * CefLoadUrlTask - Navigates a running browser to a new URL
+ *
+ * Posted to the CEF UI thread when the url property changes while the
+ * browser runs. Holds a reference on the element until it has run.
  */
-class CefClientImpl : public CefClient
+class CefLoadUrlTask : public CefTask
 {
 public:
-    CefClientImpl(CefRefPtr<CefRenderHandler> render_handler,
-                  CefRefPtr<CefLoadHandler> load_handler,
-                  CefRefPtr<CefLifeSpanHandler> lifespan_handler)
-        : render_handler_(render_handler),
-          load_handler_(load_handler),
-          lifespan_handler_(lifespan_handler)
+    CefLoadUrlTask(GstChromiumSrc* src, const gchar* url)
+        : src_(static_cast<GstChromiumSrc*>(gst_object_ref(src))),
+          generation_(g_atomic_int_get(&src->browser_generation)),
+          url_(g_strdup(url))
     {
     }
 
-    /**
-     * GetRenderHandler:
-     *
-     * Returns the render handler for offscreen rendering.
-     *
-     * Invoked by CEF when it needs to perform offscreen rendering
-     * operations.
-     */
-    CefRefPtr<CefRenderHandler> GetRenderHandler() override
+    ~CefLoadUrlTask() override
     {
-        return render_handler_;
+        g_free(url_);
+        gst_object_unref(src_);
     }
 
     /**
-     * GetLoadHandler:
+     * Execute:
      *
-     * Returns the load handler for monitoring page load events.
+     * Starts loading the URL in the main frame and drops paints until
+     * it has loaded, so create() holds the last frame of the old page.
+     * Retries shortly while the browser is still being created.
      *
-     * Invoked by CEF when a navigation begins or ends.
+     * Invoked by CEF on the UI thread during message loop work.
      */
-    CefRefPtr<CefLoadHandler> GetLoadHandler() override
+    void Execute() override
     {
-        return load_handler_;
-    }
+        g_mutex_lock(&src_->frame_mutex);
+        gboolean current = cef_browser_current(src_, generation_);
+        g_mutex_unlock(&src_->frame_mutex);
+        if (!current)
+        {
+            return;
+        }
 
-    /**
-     * GetLifeSpanHandler:
-     *
-     * Returns the lifespan handler for browser creation callbacks.
-     *
-     * Invoked by CEF during browser creation and destruction.
-     */
-    CefRefPtr<CefLifeSpanHandler> GetLifeSpanHandler() override
-    {
-        return lifespan_handler_;
+        if (!src_->cef_browser)
+        {
+            CefPostDelayedTask(TID_UI, this, 10);
+            return;
+        }
+
+        g_mutex_lock(&src_->frame_mutex);
+        src_->navigating = TRUE;
+        src_->announce_navigation = FALSE;
+        g_free(src_->navigation_url);
+        src_->navigation_url = g_strdup(url_);
+        src_->page_loaded = FALSE;
+        g_mutex_unlock(&src_->frame_mutex);
+
+        auto browser = static_cast<CefBrowser*>(src_->cef_browser);
+        browser->GetMainFrame()->LoadURL(CefString(url_));
+        DEBUG_LOG_CEF("LoadURL - url=%s", url_);
     }
 
 private:
-    CefRefPtr<CefRenderHandler> render_handler_;
-    CefRefPtr<CefLoadHandler> load_handler_;
-    CefRefPtr<CefLifeSpanHandler> lifespan_handler_;
-
-    IMPLEMENT_REFCOUNTING(CefClientImpl);
+    GstChromiumSrc* src_;
+    gint generation_;
+    gchar* url_;
+    IMPLEMENT_REFCOUNTING(CefLoadUrlTask);
 };
 
-static gboolean cef_message_loop_idle(gpointer data)
+/**
+ * cef_pump_do_work:
+ * @data: Unused
+ *
+ * Performs pending CEF message loop work for every browser in the
+ * process, including begin frames posted by cef_browser_request_frame(),
+ * then arms the fallback timer unless CEF asked for an earlier call.
+ *
+ * Invoked on the pump thread by the source cef_pump_schedule_work()
+ * attached.
+ *
+ * Returns: G_SOURCE_REMOVE always; the next call is scheduled anew
+ */
+static gboolean cef_pump_do_work(gpointer data)
 {
-    const auto src = static_cast<GstChromiumSrc*>(data);
-
-    if (!src->running)
+    g_mutex_lock(&cef_pump_mutex);
+    if (cef_pump_work_source == g_main_current_source())
     {
-        cef_idle_id = 0;
-        return G_SOURCE_REMOVE;
+        g_source_unref(cef_pump_work_source);
+        cef_pump_work_source = NULL;
     }
+    g_mutex_unlock(&cef_pump_mutex);
 
+    GstClockTime start = chromium_tracer_enabled() ? gst_util_get_timestamp() : GST_CLOCK_TIME_NONE;
     CefDoMessageLoopWork();
-    cef_message_count++;
+    chromium_tracer_record(NULL, CHROMIUM_TRACER_PUMP, start, gst_util_get_timestamp());
 
-    // Invalidate at target frame rate (every ~33ms for 30fps)
-    // Message loop runs every 10ms, so invalidate every 3rd iteration
-    if (src->page_loaded && src->cef_browser && (cef_message_count % 3 == 0))
-    {
-        auto browser = static_cast<CefBrowser*>(src->cef_browser);
-        browser->GetHost()->Invalidate(PET_VIEW);
-    }
+    cef_pump_schedule_work(CEF_PUMP_MAX_DELAY_MS);
 
-    return G_SOURCE_CONTINUE;
+    return G_SOURCE_REMOVE;
 }
 
 /**
- * cef_message_loop_thread:
- * @data: The GstChromiumSrc instance
+ * cef_pump_schedule_work:
+ * @delay_ms: Delay requested by CEF; <= 0 means as soon as possible
  *
- * Thread function that runs the CEF message loop. Continuously calls
- * CefDoMessageLoopWork() to process CEF events and periodically
- * invalidates the view to trigger repaints when the page is loaded.
+ * Schedules one CefDoMessageLoopWork() call on the pump thread. Only
+ * one call is pending at a time and the sooner one wins: a call that is
+ * already due earlier, or an idle call, is kept, and only a later timer
+ * is replaced.
  *
- * Runs in a separate GLib thread created in cef_browser_start().
- * Exits when src->running becomes FALSE.
- *
- * Returns: NULL always
+ * Invoked from any thread by CefAppImpl::OnScheduleMessagePumpWork(),
+ * and by cef_pump_do_work() for the fallback timer.
  */
-/*static gpointer cef_message_loop_thread(gpointer data)
+static void cef_pump_schedule_work(gint64 delay_ms)
 {
-    const auto src = static_cast<GstChromiumSrc*>(data);
-    int count = 0;
+    delay_ms = MAX(delay_ms, 0);
+    gint64 deadline = g_get_monotonic_time() + delay_ms * 1000;
 
-    while (src->running)
+    g_mutex_lock(&cef_pump_mutex);
+    if (cef_pump_work_source)
     {
-        CefDoMessageLoopWork();
-        count++;
-        if (count % 300 == 0)
+        if (cef_pump_work_deadline <= deadline)
         {
-            DEBUG_LOG_CEF("message_loop running (5s interval ping) Iteration #%d (page_loaded=%d, browser=%p)",
-                          count, src->page_loaded, src->cef_browser);
+            g_mutex_unlock(&cef_pump_mutex);
+            return;
         }
+        g_source_destroy(cef_pump_work_source);
+        g_source_unref(cef_pump_work_source);
+    }
 
-        if (src->page_loaded && src->cef_browser)
-        {
-            auto browser = static_cast<CefBrowser*>(src->cef_browser);
-            browser->GetHost()->Invalidate(PET_VIEW);
-        }
+    GSource* source = delay_ms > 0
+        ? g_timeout_source_new((guint)MIN(delay_ms, (gint64)G_MAXUINT))
+        : g_idle_source_new();
+    g_source_set_priority(source, G_PRIORITY_DEFAULT);
+    g_source_set_callback(source, cef_pump_do_work, NULL, NULL);
 
-        g_usleep(10000);
-    }
+    cef_pump_work_source = source;
+    cef_pump_work_deadline = deadline;
+    g_source_attach(source, cef_pump_context);
+    g_mutex_unlock(&cef_pump_mutex);
+}
+
+/**
+ * cef_pump_thread_func:
+ * @data: Unused
+ *
+ * Runs the pump thread's main loop. This thread calls CefInitialize()
+ * and is therefore CEF's UI thread for the lifetime of the process.
+ *
+ * Returns: NULL (never returns while CEF is in use)
+ */
+static gpointer cef_pump_thread_func(gpointer data)
+{
+    GMainLoop* loop = g_main_loop_new(cef_pump_context, FALSE);
+
+    g_main_context_push_thread_default(cef_pump_context);
+    g_main_loop_run(loop);
+    g_main_context_pop_thread_default(cef_pump_context);
+    g_main_loop_unref(loop);
 
     return nullptr;
-}*/
+}
 
+/**
+ * CefPumpCall - A function run synchronously on the pump thread
+ */
+typedef struct {
+    GSourceFunc func;
+    gpointer data;
+    GMutex mutex;
+    GCond cond;
+    gboolean done;
+    gboolean result;
+} CefPumpCall;
 
 /**
- * initialize_cef:
+ * cef_pump_call_dispatch:
+ * @data: The CefPumpCall to run
  *
- * Invoked by cef_browser_start() before creating a browser instance.
- * Safe to call multiple times; subsequent calls are no-ops.
+ * Runs the call's function and wakes up the waiting caller.
  *
- * Returns: TRUE on success, FALSE on failure
+ * Invoked on the pump thread for cef_pump_call_sync().
+ *
+ * Returns: G_SOURCE_REMOVE always
  */
-static gboolean initialize_cef()
+static gboolean cef_pump_call_dispatch(gpointer data)
 {
-    g_mutex_lock(&cef_init_mutex);
+    auto call = static_cast<CefPumpCall*>(data);
+    gboolean result = call->func(call->data);
+
+    g_mutex_lock(&call->mutex);
+    call->result = result;
+    call->done = TRUE;
+    g_cond_signal(&call->cond);
+    g_mutex_unlock(&call->mutex);
+
+    return G_SOURCE_REMOVE;
+}
+
+/**
+ * cef_pump_call_sync:
+ * @func: Function to run on the pump thread
+ * @data: Argument for @func
+ *
+ * Runs @func on the pump thread and waits for its result. Must not be
+ * called from the pump thread itself.
+ *
+ * Returns: The value returned by @func
+ */
+static gboolean cef_pump_call_sync(GSourceFunc func, gpointer data)
+{
+    CefPumpCall call = {};
+
+    call.func = func;
+    call.data = data;
+    g_mutex_init(&call.mutex);
+    g_cond_init(&call.cond);
+
+    g_main_context_invoke(cef_pump_context, cef_pump_call_dispatch, &call);
 
-    if (cef_initialized)
+    g_mutex_lock(&call.mutex);
+    while (!call.done)
     {
-        g_mutex_unlock(&cef_init_mutex);
-        return TRUE;
+        g_cond_wait(&call.cond, &call.mutex);
     }
+    g_mutex_unlock(&call.mutex);
 
+    g_mutex_clear(&call.mutex);
+    g_cond_clear(&call.cond);
+
+    return call.result;
+}
+
+/**
+ * cef_pump_start:
+ *
+ * Starts the pump thread once per process. Must be called with
+ * cef_init_mutex held.
+ *
+ * Invoked by initialize_cef() before CEF is initialized.
+ */
+static void cef_pump_start()
+{
+    if (cef_pump_thread)
+    {
+        return;
+    }
+
+    cef_pump_context = g_main_context_new();
+    cef_pump_thread = g_thread_new("chromiumsrc-cef", cef_pump_thread_func, NULL);
+    DEBUG_LOG_CEF("Started CEF pump thread");
+}
+
+/**
+ * cef_initialize_on_pump_thread:
+ * @data: Unused
+ *
+ * Configures and initializes CEF with an external message pump. Runs on
+ * the pump thread, which thereby becomes CEF's UI thread.
+ *
+ * Invoked through cef_pump_call_sync() by initialize_cef().
+ *
+ * Returns: TRUE on success, FALSE on failure
+ */
+static gboolean cef_initialize_on_pump_thread(gpointer data)
+{
     /**
      * CefAppImpl - CEF application handler for command line processing
      *
@@ -497,6 +1485,18 @@ static gboolean initialize_cef()
             return this;
         }
 
+        /**
+         * OnScheduleMessagePumpWork:
+         * @delay_ms: Delay before CEF wants its work done
+         *
+         * Called from any thread when CEF has work for the UI thread.
+         * Forwards the request to the pump thread.
+         */
+        void OnScheduleMessagePumpWork(int64_t delay_ms) override
+        {
+            cef_pump_schedule_work(delay_ms);
+        }
+
         /**
          * OnBeforeChildProcessLaunch:
          * @command_line: The command line that will be passed to the child process
@@ -576,6 +1576,7 @@ static gboolean initialize_cef()
     settings.windowless_rendering_enabled = TRUE;
     settings.log_severity = LOGSEVERITY_INFO;
     settings.multi_threaded_message_loop = FALSE;
+    settings.external_message_pump = TRUE;
 
     // Disable GPU if configured
     if (gpu_config && !gpu_config->enabled)
@@ -616,7 +1617,6 @@ static gboolean initialize_cef()
     if (!found_subprocess)
     {
         g_free(home_subprocess);
-        g_mutex_unlock(&cef_init_mutex);
         g_critical("chromiumsrc: subprocess binary 'chromiumsrc-subprocess' not found. "
             "Set CHROMIUMSRC_SUBPROCESS_PATH or install to ~/.local/share/gstreamer-1.0/plugins/");
         DEBUG_LOG_CEF("initialize_cef - FAILED: subprocess binary not found");
@@ -669,19 +1669,85 @@ static gboolean initialize_cef()
     // Initialize CEF
     if (!CefInitialize(main_args, settings, app, nullptr))
     {
-        g_mutex_unlock(&cef_init_mutex);
         DEBUG_LOG_CEF("initialize_cef - CefInitialize FAILED");
         return FALSE;
     }
 
-    cef_initialized = TRUE;
+    return TRUE;
+}
+
+/**
+ * initialize_cef:
+ *
+ * Starts the pump thread and initializes CEF on it.
+ *
+ * Invoked by cef_browser_start() before creating a browser instance.
+ * Safe to call multiple times and from any thread; subsequent calls
+ * are no-ops.
+ *
+ * Returns: TRUE on success, FALSE on failure
+ */
+static gboolean initialize_cef()
+{
+    g_mutex_lock(&cef_init_mutex);
+
+    if (!cef_initialized)
+    {
+        cef_pump_start();
+        cef_initialized = cef_pump_call_sync(cef_initialize_on_pump_thread, NULL);
+    }
+
+    gboolean result = cef_initialized;
     g_mutex_unlock(&cef_init_mutex);
 
-    return TRUE;
+    return result;
 }
 
+/**
+ * cef_prewarm_thread_func:
+ * @data: Unused
+ *
+ * Initializes CEF, blocking only this short-lived thread.
+ *
+ * Returns: NULL always
+ */
+static gpointer cef_prewarm_thread_func(gpointer data)
+{
+    if (!initialize_cef())
+    {
+        DEBUG_LOG("cef_prewarm - CEF initialization FAILED");
+    }
+
+    return nullptr;
+}
 
 extern "C" {
+/**
+ * cef_prewarm:
+ * @gpu: "true", "false" or "auto", like the element's gpu property
+ *
+ * Starts initializing CEF (pump thread, CefInitialize(), GPU and
+ * utility subprocesses) in the background, so the first browser does
+ * not pay for it. GPU mode is fixed for the process here, since it
+ * cannot change after CEF is initialized.
+ *
+ * Invoked by plugin_init() when CHROMIUMSRC_PREWARM is set. Returns
+ * immediately; cef_browser_start() waits for the initialization.
+ */
+void cef_prewarm(const gchar* gpu)
+{
+    gboolean user_specified = g_strcmp0(gpu, "true") == 0 || g_strcmp0(gpu, "false") == 0;
+
+    g_mutex_lock(&cef_init_mutex);
+    if (!gpu_config)
+    {
+        gpu_decide_config(user_specified, g_strcmp0(gpu, "true") == 0);
+    }
+    g_mutex_unlock(&cef_init_mutex);
+
+    g_thread_unref(g_thread_new("chromiumsrc-prewarm", cef_prewarm_thread_func, NULL));
+}
+
 /**
  * cef_browser_start:
  * @src: The GstChromiumSrc instance
@@ -693,8 +1759,8 @@ extern "C" {
  * Initializes CEF if not already done, creates handlers, configures
  * windowless rendering, and launches the message loop thread.
  *
- * Invoked by gst_chromium_src_start() during the READY_TO_PAUSED
- * state transition.
+ * Invoked by gst_chromium_src_open_browser() during the NULL_TO_READY
+ * state transition, or from READY_TO_PAUSED when the settings changed.
  *
  * Returns: TRUE on success, FALSE on failure
  */
@@ -708,46 +1774,62 @@ gboolean cef_browser_start(GstChromiumSrc* src, const gchar* url, gint width, gi
         return FALSE;
     }
 
-    // Pump message loop a few times to let CEF finish initialization
-    for (int i = 0; i < 10; i++)
-    {
-        CefDoMessageLoopWork();
-        g_usleep(1000);
-    }
     DEBUG_LOG_CEF("CEF initialization complete, creating browser...");
 
+    // Callbacks and tasks of earlier browsers are ignored from here on
+    g_mutex_lock(&src->frame_mutex);
+    gint generation = g_atomic_int_add(&src->browser_generation, 1) + 1;
     src->page_loaded = FALSE;
+    src->page_ready = FALSE;
+    src->budget_granted = 0;
+    src->budget_expired = 0;
+    src->budget_frame = 0;
+    src->timeline = FALSE;
+    src->navigating = FALSE;
+    src->repaint = FALSE;
+    src->announce_navigation = FALSE;
+    g_mutex_unlock(&src->frame_mutex);
 
     // Step 3: Create CEF handlers
-    CefRefPtr<CefRenderHandlerImpl> render_handler = new CefRenderHandlerImpl(src, width, height);
+    CefRefPtr<CefRenderHandlerImpl> render_handler =
+        new CefRenderHandlerImpl(src, generation, width, height);
 
-    CefRefPtr<CefLoadHandlerImpl> load_handler = new CefLoadHandlerImpl(src);
+    CefRefPtr<CefLoadHandlerImpl> load_handler = new CefLoadHandlerImpl(src, generation);
 
-    CefRefPtr<CefLifeSpanHandlerImpl> lifespan_handler = new CefLifeSpanHandlerImpl(src);
+    CefRefPtr<CefLifeSpanHandlerImpl> lifespan_handler = new CefLifeSpanHandlerImpl(src, generation);
 
     // Step 4: Create CEF client
-    CefRefPtr<CefClientImpl> client = new CefClientImpl(render_handler, load_handler, lifespan_handler);
+    CefRefPtr<CefClientImpl> client =
+        new CefClientImpl(src, generation, render_handler, load_handler, lifespan_handler);
 
     // Step 5: Configure windowless rendering
     CefWindowInfo window_info;
     window_info.SetAsWindowless(0);
+    window_info.external_begin_frame_enabled = true;
 
-    // Step 6: Configure browser settings
+    // Step 6: Configure browser settings (frames are paced by external
+    // begin frames, the windowless rate only bounds Chromium's own timers
+    // and is capped at 60 by CEF)
     CefBrowserSettings browser_settings;
-    browser_settings.windowless_frame_rate = src->fps_num;
+    browser_settings.windowless_frame_rate =
+        CLAMP((src->fps_n + src->fps_d - 1) / src->fps_d, 1, 60);
+    if (src->alpha_mode == GST_CHROMIUM_SRC_ALPHA_STRAIGHT)
+    {
+        // Let pages without a background of their own come out keyed
+        browser_settings.background_color = CefColorSetARGB(0, 0, 0, 0);
+    }
 
     CefString cef_url(url);
 
-    // Step 7: Store client reference
-    src->cef_client = static_cast<gpointer>(client.get());
+    // Step 7: Store client reference and accept frames (CEF work runs
+    // on the pump thread)
     client->AddRef();
-
-    // Step 8: Start message loop via GLib idle callback (runs on main thread)
+    g_mutex_lock(&src->frame_mutex);
+    src->cef_client = static_cast<gpointer>(client.get());
     src->running = TRUE;
-    cef_idle_id = g_timeout_add(8, cef_message_loop_idle, src);
-    DEBUG_LOG_CEF("Started CEF message loop timeout callback (id=%u)", cef_idle_id);
+    g_mutex_unlock(&src->frame_mutex);
 
-    // Step 9: Create browser asynchronously
+    // Step 8: Create browser asynchronously
     DEBUG_LOG_CEF("CreateBrowser - url=%s, client=%p, windowless=%d",
                   url, client.get(), window_info.windowless_rendering_enabled);
 
@@ -760,12 +1842,9 @@ gboolean cef_browser_start(GstChromiumSrc* src, const gchar* url, gint width, gi
         nullptr))
     {
         DEBUG_LOG_CEF("cef_browser_start - CreateBrowser FAILED");
+        g_mutex_lock(&src->frame_mutex);
         src->running = FALSE;
-        if (cef_idle_id)
-        {
-            g_source_remove(cef_idle_id);
-            cef_idle_id = 0;
-        }
+        g_mutex_unlock(&src->frame_mutex);
         return FALSE;
     }
 
@@ -775,36 +1854,113 @@ gboolean cef_browser_start(GstChromiumSrc* src, const gchar* url, gint width, gi
 }
 
 /**
- * cef_browser_stop:
+ * cef_browser_request_frame:
  * @src: The GstChromiumSrc instance
  *
- * Stops and cleans up the CEF browser instance. Signals the message
- * loop thread to stop, waits for it to join, closes the browser,
- * and releases all CEF references.
+ * Asks Chromium to render one frame by posting a begin frame task to
+ * the CEF UI thread. The resulting OnPaint() fills the next output slot.
  *
- * Invoked by gst_chromium_src_stop() during the PAUSED_TO_READY
- * state transition.
+ * Invoked by gst_chromium_src_create() once per output slot. Safe to
+ * call from any thread.
  */
-void cef_browser_stop(GstChromiumSrc* src)
+void cef_browser_request_frame(GstChromiumSrc* src)
 {
-    DEBUG_LOG("=== CEF Browser Stop ===");
+    if (!src->running)
+    {
+        return;
+    }
 
-    if (!src)
+    CefPostTask(TID_UI, new CefBeginFrameTask(src));
+}
+
+/**
+ * cef_browser_advance_time:
+ * @src: The GstChromiumSrc instance
+ * @duration: Virtual time to let pass
+ * @timeline: Time to set the page's animations to, or
+ *   GST_CLOCK_TIME_NONE to leave them running on virtual time
+ *
+ * Advances the virtual time of a non-live element's page, so timers,
+ * performance.now() and animations move on by @duration. Once the
+ * budget expired a begin frame is requested. Safe to call from any
+ * thread.
+ *
+ * Invoked by gst_chromium_src_create() once per buffer when not live.
+ */
+void cef_browser_advance_time(GstChromiumSrc* src, GstClockTime duration, GstClockTime timeline)
+{
+    if (!src->running)
     {
-        DEBUG_LOG("cef_browser_stop - Source is NULL, nothing to stop");
         return;
     }
 
-    // Step 1: Stop message loop idle callback
-    src->running = FALSE;
-    if (cef_idle_id)
+    CefPostTask(TID_UI, new CefVirtualTimeTask(src, (double)duration / GST_MSECOND, timeline));
+}
+
+/**
+ * cef_browser_resize:
+ * @src: The GstChromiumSrc instance
+ * @width: New view width in pixels
+ * @height: New view height in pixels
+ *
+ * Changes the size the page is laid out and painted at. Paints of the
+ * old size that are still in flight are dropped. Safe to call from any
+ * thread.
+ *
+ * Invoked by gst_chromium_src_set_caps() when negotiation picked a
+ * size other than the current view.
+ */
+void cef_browser_resize(GstChromiumSrc* src, gint width, gint height)
+{
+    g_mutex_lock(&src->frame_mutex);
+    src->view_width = width;
+    src->view_height = height;
+    g_mutex_unlock(&src->frame_mutex);
+
+    if (src->running)
+    {
+        CefPostTask(TID_UI, new CefResizeTask(src));
+    }
+}
+
+/**
+ * cef_browser_load_url:
+ * @src: The GstChromiumSrc instance
+ * @url: The URL to navigate to
+ *
+ * Navigates the running browser to @url on the CEF UI thread, keeping
+ * the renderer and output caps. Safe to call from any thread.
+ *
+ * Invoked by gst_chromium_src_set_property() when url changes while
+ * the browser runs.
+ */
+void cef_browser_load_url(GstChromiumSrc* src, const gchar* url)
+{
+    if (!src->running)
     {
-        g_source_remove(cef_idle_id);
-        cef_idle_id = 0;
-        DEBUG_LOG("cef_browser_stop - CEF idle callback removed");
+        return;
     }
 
-    // Step 2: Close browser
+    CefPostTask(TID_UI, new CefLoadUrlTask(src, url));
+}
+
+/**
+ * cef_browser_close_on_pump_thread:
+ * @data: The GstChromiumSrc instance
+ *
+ * Closes the browser and releases the browser and client references.
+ * Running on the UI thread serializes this with the tasks that use
+ * src->cef_browser, so none of them sees a released browser.
+ *
+ * Invoked through cef_pump_call_sync() by cef_browser_stop().
+ *
+ * Returns: TRUE always
+ */
+static gboolean cef_browser_close_on_pump_thread(gpointer data)
+{
+    auto src = static_cast<GstChromiumSrc*>(data);
+
+    // Step 1: Close browser
     if (src->cef_browser)
     {
         CefBrowser* browser = static_cast<CefBrowser*>(src->cef_browser);
@@ -818,17 +1974,61 @@ void cef_browser_stop(GstChromiumSrc* src)
         DEBUG_LOG("cef_browser_stop - No browser to close");
     }
 
-    // Step 3: Release client
-    if (src->cef_client)
+    // Step 2: Release client
+    g_mutex_lock(&src->frame_mutex);
+    CefClient* client = static_cast<CefClient*>(src->cef_client);
+    src->cef_client = NULL;
+    g_mutex_unlock(&src->frame_mutex);
+    if (client)
     {
-        CefClient* client = static_cast<CefClient*>(src->cef_client);
         client->Release();
-        src->cef_client = NULL;
         DEBUG_LOG("cef_browser_stop - Client released");
     }
     else
     {
         DEBUG_LOG("cef_browser_stop - No client to release");
     }
+
+    return TRUE;
+}
+
+/**
+ * cef_browser_stop:
+ * @src: The GstChromiumSrc instance
+ *
+ * Stops and cleans up the CEF browser instance: stops accepting frames,
+ * then closes the browser and releases all CEF references on the UI
+ * thread. Must not be called from the UI thread. Closing is asynchronous:
+ * handlers and tasks of the closed browser keep a reference on the
+ * element and ignore whatever arrives after this (see
+ * cef_browser_current()).
+ *
+ * Invoked by gst_chromium_src_close_browser() during the READY_TO_NULL
+ * state transition.
+ */
+void cef_browser_stop(GstChromiumSrc* src)
+{
+    DEBUG_LOG("=== CEF Browser Stop ===");
+
+    if (!src)
+    {
+        DEBUG_LOG("cef_browser_stop - Source is NULL, nothing to stop");
+        return;
+    }
+
+    // Step 1: Stop accepting frames and events of this browser
+    g_mutex_lock(&src->frame_mutex);
+    src->running = FALSE;
+    g_mutex_unlock(&src->frame_mutex);
+
+    // Step 2: Close the browser between UI thread tasks
+    if (cef_pump_context)
+    {
+        cef_pump_call_sync(cef_browser_close_on_pump_thread, src);
+    }
+    else
+    {
+        cef_browser_close_on_pump_thread(src);
+    }
 }
 }
@@ -9,8 +9,13 @@
 
 G_BEGIN_DECLS
 
+void cef_prewarm(const gchar *gpu);
 gboolean cef_browser_start(GstChromiumSrc *src, const gchar *url, gint width, gint height);
 void cef_browser_stop(GstChromiumSrc *src);
+void cef_browser_request_frame(GstChromiumSrc *src);
+void cef_browser_advance_time(GstChromiumSrc *src, GstClockTime duration, GstClockTime timeline);
+void cef_browser_load_url(GstChromiumSrc *src, const gchar *url);
+void cef_browser_resize(GstChromiumSrc *src, gint width, gint height);
 
 G_END_DECLS
 
@@ -0,0 +1,403 @@
+#include "chromium_tracer.h"
+#include "gstchromiumsrc.h"
+
+#include <string.h>
+
+GST_DEBUG_CATEGORY_STATIC(chromium_tracer_debug);
+#define GST_CAT_DEFAULT chromium_tracer_debug
+
+/* Histogram buckets: bucket i counts spans shorter than 2^i microseconds */
+#define CHROMIUM_TRACER_BUCKETS 32
+
+static const gchar *stage_names[CHROMIUM_TRACER_N_STAGES] = {
+    "pump", "paint", "queue", "push"
+};
+
+/**
+ * ChromiumTracerSpans - Timing of one stage
+ */
+typedef struct {
+    guint64 count;
+    GstClockTime min;
+    GstClockTime max;
+    GstClockTime sum;
+    guint64 buckets[CHROMIUM_TRACER_BUCKETS];
+} ChromiumTracerSpans;
+
+/**
+ * ChromiumTracerElement - Stages recorded for one chromiumsrc
+ *
+ * The process-wide CEF message pump is recorded under a NULL element.
+ */
+typedef struct {
+    GstChromiumTracer *tracer;
+    GstElement *element;
+    gchar *name;
+    GstClockTime push_start;
+    ChromiumTracerSpans stages[CHROMIUM_TRACER_N_STAGES];
+} ChromiumTracerElement;
+
+/* The tracer instance created for GST_TRACERS, if any */
+static GstChromiumTracer *active_tracer = NULL;
+
+static GstTracerRecord *tr_stage = NULL;
+
+G_DEFINE_TYPE(GstChromiumTracer, gst_chromium_tracer, GST_TYPE_TRACER);
+
+/**
+ * chromium_tracer_spans_reset:
+ * @entry: The element to reset
+ *
+ * Clears all stage timings of @entry.
+ */
+static void chromium_tracer_spans_reset(ChromiumTracerElement *entry) {
+    memset(entry->stages, 0, sizeof(entry->stages));
+    for (guint i = 0; i < CHROMIUM_TRACER_N_STAGES; i++) {
+        entry->stages[i].min = GST_CLOCK_TIME_NONE;
+    }
+    entry->push_start = GST_CLOCK_TIME_NONE;
+}
+
+/**
+ * chromium_tracer_log:
+ * @entry: The element whose stages to log
+ *
+ * Logs one chromiumsrc-stage record per stage that saw spans, with
+ * count, min/avg/max in nanoseconds and the non-empty histogram
+ * buckets as "<2us:5 <4us:17 ...", then starts a new period.
+ */
+static void chromium_tracer_log(ChromiumTracerElement *entry) {
+    for (guint i = 0; i < CHROMIUM_TRACER_N_STAGES; i++) {
+        ChromiumTracerSpans *spans = &entry->stages[i];
+        GString *histogram;
+
+        if (!spans->count) {
+            continue;
+        }
+
+        histogram = g_string_new(NULL);
+        for (guint b = 0; b < CHROMIUM_TRACER_BUCKETS; b++) {
+            if (spans->buckets[b]) {
+                g_string_append_printf(histogram, "%s<%" G_GUINT64_FORMAT "us:%" G_GUINT64_FORMAT,
+                    histogram->len ? " " : "", (guint64)1 << b, spans->buckets[b]);
+            }
+        }
+
+        gst_tracer_record_log(tr_stage, entry->name, stage_names[i], spans->count,
+            spans->min, spans->sum / spans->count, spans->max, histogram->str);
+        g_string_free(histogram, TRUE);
+    }
+
+    chromium_tracer_spans_reset(entry);
+}
+
+/**
+ * chromium_tracer_element_gone:
+ * @data: The ChromiumTracerElement
+ * @element: The element being finalized
+ *
+ * Logs what is left of a chromiumsrc that never saw EOS and forgets it,
+ * so a later element at the same address starts from zero.
+ *
+ * Invoked by GObject when a traced chromiumsrc is finalized.
+ */
+static void chromium_tracer_element_gone(gpointer data, GObject *element) {
+    ChromiumTracerElement *entry = (ChromiumTracerElement *)data;
+    GstChromiumTracer *self = entry->tracer;
+
+    g_mutex_lock(&self->lock);
+    chromium_tracer_log(entry);
+    entry->element = NULL;
+    g_hash_table_remove(self->elements, element);
+    g_mutex_unlock(&self->lock);
+}
+
+/**
+ * chromium_tracer_element_free:
+ * @data: The ChromiumTracerElement
+ *
+ * Releases an entry, dropping its weak reference if the element is
+ * still alive.
+ */
+static void chromium_tracer_element_free(gpointer data) {
+    ChromiumTracerElement *entry = (ChromiumTracerElement *)data;
+
+    if (entry->element) {
+        g_object_weak_unref(G_OBJECT(entry->element), chromium_tracer_element_gone, entry);
+    }
+    g_free(entry->name);
+    g_free(entry);
+}
+
+/**
+ * chromium_tracer_lookup:
+ * @self: The tracer
+ * @element: (nullable): The chromiumsrc, or NULL for the CEF pump
+ *
+ * Finds or creates the entry for @element. Must be called with the
+ * tracer lock held.
+ *
+ * Returns: The entry
+ */
+static ChromiumTracerElement *chromium_tracer_lookup(GstChromiumTracer *self, GstElement *element) {
+    ChromiumTracerElement *entry =
+        (ChromiumTracerElement *)g_hash_table_lookup(self->elements, element);
+
+    if (!entry) {
+        entry = g_new0(ChromiumTracerElement, 1);
+        entry->tracer = self;
+        entry->element = element;
+        entry->name = element ? gst_object_get_path_string(GST_OBJECT(element))
+                              : g_strdup("cef-pump");
+        chromium_tracer_spans_reset(entry);
+        if (element) {
+            g_object_weak_ref(G_OBJECT(element), chromium_tracer_element_gone, entry);
+        }
+        g_hash_table_insert(self->elements, element, entry);
+    }
+
+    return entry;
+}
+
+/**
+ * chromium_tracer_add:
+ * @spans: The stage to add to
+ * @duration: Length of the span
+ *
+ * Adds one span to a stage's statistics and histogram.
+ */
+static void chromium_tracer_add(ChromiumTracerSpans *spans, GstClockTime duration) {
+    guint bucket = g_bit_storage(duration / GST_USECOND);
+
+    spans->count++;
+    spans->sum += duration;
+    spans->min = MIN(spans->min, duration);
+    spans->max = MAX(spans->max, duration);
+    spans->buckets[MIN(bucket, CHROMIUM_TRACER_BUCKETS - 1)]++;
+}
+
+/**
+ * chromium_tracer_source:
+ * @pad: A pad from a tracer hook
+ *
+ * Returns: The chromiumsrc owning @pad, or NULL for any other pad
+ */
+static GstElement *chromium_tracer_source(GstPad *pad) {
+    GstObject *parent = GST_OBJECT_PARENT(pad);
+
+    return parent && GST_IS_CHROMIUM_SRC(parent) ? GST_ELEMENT(parent) : NULL;
+}
+
+/**
+ * chromium_tracer_push_pre:
+ * @self: The tracer
+ * @ts: Hook timestamp
+ * @pad: The pad pushing
+ * @buffer: The buffer
+ *
+ * Starts a push span for chromiumsrc source pads.
+ *
+ * Invoked on the streaming thread before every gst_pad_push().
+ */
+static void chromium_tracer_push_pre(GstChromiumTracer *self, GstClockTime ts, GstPad *pad,
+                                     GstBuffer *buffer) {
+    GstElement *element = chromium_tracer_source(pad);
+
+    if (!element) {
+        return;
+    }
+
+    g_mutex_lock(&self->lock);
+    chromium_tracer_lookup(self, element)->push_start = ts;
+    g_mutex_unlock(&self->lock);
+}
+
+/**
+ * chromium_tracer_push_post:
+ * @self: The tracer
+ * @ts: Hook timestamp
+ * @pad: The pad that pushed
+ * @res: Result of the push
+ *
+ * Ends the push span; a long one means downstream backpressure.
+ *
+ * Invoked on the streaming thread after every gst_pad_push().
+ */
+static void chromium_tracer_push_post(GstChromiumTracer *self, GstClockTime ts, GstPad *pad,
+                                      GstFlowReturn res) {
+    GstElement *element = chromium_tracer_source(pad);
+
+    if (!element) {
+        return;
+    }
+
+    g_mutex_lock(&self->lock);
+    ChromiumTracerElement *entry = chromium_tracer_lookup(self, element);
+    if (GST_CLOCK_TIME_IS_VALID(entry->push_start) && ts >= entry->push_start) {
+        chromium_tracer_add(&entry->stages[CHROMIUM_TRACER_PUSH], ts - entry->push_start);
+    }
+    entry->push_start = GST_CLOCK_TIME_NONE;
+    g_mutex_unlock(&self->lock);
+}
+
+/**
+ * chromium_tracer_push_event_pre:
+ * @self: The tracer
+ * @ts: Hook timestamp
+ * @pad: The pad pushing
+ * @event: The event
+ *
+ * Logs the stage histograms of a chromiumsrc when it sends EOS, plus
+ * those of the shared CEF pump.
+ *
+ * Invoked before every gst_pad_push_event().
+ */
+static void chromium_tracer_push_event_pre(GstChromiumTracer *self, GstClockTime ts, GstPad *pad,
+                                           GstEvent *event) {
+    GstElement *element;
+
+    if (GST_EVENT_TYPE(event) != GST_EVENT_EOS || !(element = chromium_tracer_source(pad))) {
+        return;
+    }
+
+    g_mutex_lock(&self->lock);
+    chromium_tracer_log(chromium_tracer_lookup(self, element));
+    chromium_tracer_log(chromium_tracer_lookup(self, NULL));
+    g_mutex_unlock(&self->lock);
+}
+
+/**
+ * chromium_tracer_enabled:
+ *
+ * Lets the element skip taking timestamps when nobody traces it.
+ *
+ * Returns: TRUE if GST_TRACERS created a chromiumtrace tracer
+ */
+gboolean chromium_tracer_enabled(void) {
+    return g_atomic_pointer_get(&active_tracer) != NULL;
+}
+
+/**
+ * chromium_tracer_record:
+ * @element: (nullable): The chromiumsrc, or NULL for the CEF pump
+ * @stage: The stage the span belongs to
+ * @start: Start of the span, from gst_util_get_timestamp()
+ * @end: End of the span, from gst_util_get_timestamp()
+ *
+ * Records one span of the frame path. Does nothing without an active
+ * tracer.
+ *
+ * Invoked from the CEF UI thread and the streaming threads.
+ */
+void chromium_tracer_record(GstElement *element, ChromiumTracerStage stage,
+                            GstClockTime start, GstClockTime end) {
+    GstChromiumTracer *self = (GstChromiumTracer *)g_atomic_pointer_get(&active_tracer);
+
+    if (!self || !GST_CLOCK_TIME_IS_VALID(start) || end < start) {
+        return;
+    }
+
+    g_mutex_lock(&self->lock);
+    chromium_tracer_add(&chromium_tracer_lookup(self, element)->stages[stage], end - start);
+    g_mutex_unlock(&self->lock);
+}
+
+/**
+ * gst_chromium_tracer_finalize:
+ * @object: The tracer
+ *
+ * Logs everything not logged at EOS yet and stops recording.
+ *
+ * Invoked by gst_deinit() when the tracer is released.
+ */
+static void gst_chromium_tracer_finalize(GObject *object) {
+    GstChromiumTracer *self = GST_CHROMIUM_TRACER(object);
+    GHashTableIter iter;
+    gpointer entry;
+
+    g_atomic_pointer_compare_and_exchange(&active_tracer, self, NULL);
+
+    g_mutex_lock(&self->lock);
+    g_hash_table_iter_init(&iter, self->elements);
+    while (g_hash_table_iter_next(&iter, NULL, &entry)) {
+        chromium_tracer_log((ChromiumTracerElement *)entry);
+    }
+    g_hash_table_destroy(self->elements);
+    g_mutex_unlock(&self->lock);
+    g_mutex_clear(&self->lock);
+
+    G_OBJECT_CLASS(gst_chromium_tracer_parent_class)->finalize(object);
+}
+
+/**
+ * gst_chromium_tracer_class_init:
+ * @klass: The class structure to initialize
+ *
+ * Describes the chromiumsrc-stage record logged per element and stage.
+ */
+static void gst_chromium_tracer_class_init(GstChromiumTracerClass *klass) {
+    GObjectClass *gobject_class = G_OBJECT_CLASS(klass);
+
+    GST_DEBUG_CATEGORY_INIT(chromium_tracer_debug, "chromiumtrace", 0,
+        "Chromium Source frame path tracer");
+
+    gobject_class->finalize = gst_chromium_tracer_finalize;
+
+    tr_stage = gst_tracer_record_new("chromiumsrc-stage.class",
+        "element", GST_TYPE_STRUCTURE, gst_structure_new("scope",
+            "type", G_TYPE_GTYPE, G_TYPE_STRING,
+            "related", GST_TYPE_TRACER_VALUE_SCOPE, GST_TRACER_VALUE_SCOPE_ELEMENT,
+            NULL),
+        "stage", GST_TYPE_STRUCTURE, gst_structure_new("value",
+            "type", G_TYPE_GTYPE, G_TYPE_STRING,
+            "description", G_TYPE_STRING, "pump, paint, queue or push",
+            NULL),
+        "count", GST_TYPE_STRUCTURE, gst_structure_new("value",
+            "type", G_TYPE_GTYPE, G_TYPE_UINT64,
+            "description", G_TYPE_STRING, "Spans recorded",
+            NULL),
+        "min", GST_TYPE_STRUCTURE, gst_structure_new("value",
+            "type", G_TYPE_GTYPE, G_TYPE_UINT64,
+            "description", G_TYPE_STRING, "Shortest span in ns",
+            NULL),
+        "avg", GST_TYPE_STRUCTURE, gst_structure_new("value",
+            "type", G_TYPE_GTYPE, G_TYPE_UINT64,
+            "description", G_TYPE_STRING, "Average span in ns",
+            NULL),
+        "max", GST_TYPE_STRUCTURE, gst_structure_new("value",
+            "type", G_TYPE_GTYPE, G_TYPE_UINT64,
+            "description", G_TYPE_STRING, "Longest span in ns",
+            NULL),
+        "histogram", GST_TYPE_STRUCTURE, gst_structure_new("value",
+            "type", G_TYPE_GTYPE, G_TYPE_STRING,
+            "description", G_TYPE_STRING, "Non-empty power of two buckets",
+            NULL),
+        NULL);
+    GST_OBJECT_FLAG_SET(tr_stage, GST_OBJECT_FLAG_MAY_BE_LEAKED);
+}
+
+/**
+ * gst_chromium_tracer_init:
+ * @self: The instance to initialize
+ *
+ * Hooks the source pad pushes of chromiumsrc elements and makes this
+ * the tracer the element reports its internal stages to.
+ *
+ * Invoked when GST_TRACERS names chromiumtrace.
+ */
+static void gst_chromium_tracer_init(GstChromiumTracer *self) {
+    GstTracer *tracer = GST_TRACER(self);
+
+    g_mutex_init(&self->lock);
+    self->elements = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL,
+        chromium_tracer_element_free);
+
+    gst_tracing_register_hook(tracer, "pad-push-pre", G_CALLBACK(chromium_tracer_push_pre));
+    gst_tracing_register_hook(tracer, "pad-push-post", G_CALLBACK(chromium_tracer_push_post));
+    gst_tracing_register_hook(tracer, "pad-push-event-pre",
+        G_CALLBACK(chromium_tracer_push_event_pre));
+
+    if (!g_atomic_pointer_compare_and_exchange(&active_tracer, NULL, self)) {
+        GST_WARNING_OBJECT(self, "Another chromiumtrace tracer is active, only pushes are traced");
+    }
+}
@@ -0,0 +1,43 @@
+#ifndef __CHROMIUM_TRACER_H__
+#define __CHROMIUM_TRACER_H__
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+#define GST_TYPE_CHROMIUM_TRACER (gst_chromium_tracer_get_type())
+#define GST_CHROMIUM_TRACER(obj) \
+    (G_TYPE_CHECK_INSTANCE_CAST((obj), GST_TYPE_CHROMIUM_TRACER, GstChromiumTracer))
+
+/* Stages of the frame path timed by the tracer */
+typedef enum {
+    CHROMIUM_TRACER_PUMP,   /* One CefDoMessageLoopWork() call, shared by all instances */
+    CHROMIUM_TRACER_PAINT,  /* OnPaint() copying into the pooled buffer */
+    CHROMIUM_TRACER_QUEUE,  /* Paint received until create() took the buffer (includes the copy) */
+    CHROMIUM_TRACER_PUSH,   /* gst_pad_push() of a buffer, i.e. downstream */
+    CHROMIUM_TRACER_N_STAGES
+} ChromiumTracerStage;
+
+typedef struct _GstChromiumTracer GstChromiumTracer;
+typedef struct _GstChromiumTracerClass GstChromiumTracerClass;
+
+struct _GstChromiumTracer {
+    GstTracer parent;
+
+    GMutex lock;
+    GHashTable *elements;
+};
+
+struct _GstChromiumTracerClass {
+    GstTracerClass parent_class;
+};
+
+GType gst_chromium_tracer_get_type(void);
+
+gboolean chromium_tracer_enabled(void);
+void chromium_tracer_record(GstElement *element, ChromiumTracerStage stage,
+                            GstClockTime start, GstClockTime end);
+
+G_END_DECLS
+
+#endif
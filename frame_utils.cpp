@@ -0,0 +1,624 @@
+#include "frame_utils.h"
+
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define FRAME_HAVE_AVX2 1
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define FRAME_HAVE_NEON 1
+#endif
+
+/* CEF paints are packed 32-bit BGRA (premultiplied alpha) */
+#define FRAME_BYTES_PER_PIXEL 4
+
+/* Fraction bits of the YUV coefficients. Chroma is computed from the sum
+ * of a 2x2 block, which costs two more bits of shift */
+#define FRAME_YUV_SHIFT 14
+#define FRAME_YUV_ROUND (1 << (FRAME_YUV_SHIFT - 1))
+#define FRAME_UV_SHIFT (FRAME_YUV_SHIFT + 2)
+#define FRAME_UV_ROUND (1 << (FRAME_UV_SHIFT - 1))
+
+typedef void (*FramePixelRowFunc)(guint8 *dst, const guint8 *src, gint n);
+typedef void (*FrameYRowFunc)(guint8 *dst, const guint8 *src, gint n,
+                              const FrameYuvMatrix *matrix);
+typedef void (*FrameUvRowFunc)(guint8 *u, guint8 *v, gint step,
+                               const guint8 *row0, const guint8 *row1, gint n,
+                               const FrameYuvMatrix *matrix);
+
+/**
+ * frame_rect_clip:
+ * @rect: The rectangle to clip in place
+ * @width: Frame width in pixels
+ * @height: Frame height in pixels
+ *
+ * Clips a rectangle to the frame bounds.
+ *
+ * Returns: TRUE if anything of the rectangle is left inside the frame
+ */
+gboolean frame_rect_clip(FrameRect *rect, gint width, gint height) {
+    gint x1 = CLAMP(rect->x, 0, width);
+    gint y1 = CLAMP(rect->y, 0, height);
+    gint x2 = CLAMP(rect->x + rect->width, 0, width);
+    gint y2 = CLAMP(rect->y + rect->height, 0, height);
+
+    rect->x = x1;
+    rect->y = y1;
+    rect->width = x2 - x1;
+    rect->height = y2 - y1;
+
+    return rect->width > 0 && rect->height > 0;
+}
+
+/**
+ * frame_copy_rect:
+ * @dst: Destination frame (first pixel of the plane)
+ * @dst_stride: Destination stride in bytes
+ * @src: Source frame (first pixel of the plane)
+ * @src_stride: Source stride in bytes
+ * @rect: The already clipped rectangle to copy
+ *
+ * Copies one rectangle between two BGRA frames of equal size. Whole
+ * frames with matching strides are copied with a single memcpy.
+ *
+ * Returns: Number of bytes copied
+ */
+gsize frame_copy_rect(guint8 *dst, gint dst_stride,
+                      const guint8 *src, gint src_stride,
+                      const FrameRect *rect) {
+    gsize row = (gsize)rect->width * FRAME_BYTES_PER_PIXEL;
+    gsize offset_dst = (gsize)rect->y * dst_stride + (gsize)rect->x * FRAME_BYTES_PER_PIXEL;
+    gsize offset_src = (gsize)rect->y * src_stride + (gsize)rect->x * FRAME_BYTES_PER_PIXEL;
+
+    if (rect->x == 0 && dst_stride == src_stride && row == (gsize)src_stride) {
+        memcpy(dst + offset_dst, src + offset_src, row * rect->height);
+        return row * rect->height;
+    }
+
+    for (gint y = 0; y < rect->height; y++) {
+        memcpy(dst + offset_dst + (gsize)y * dst_stride,
+               src + offset_src + (gsize)y * src_stride, row);
+    }
+
+    return row * rect->height;
+}
+
+
+/**
+ * frame_yuv_matrix_init:
+ * @matrix: The matrix to fill
+ * @kr: Red weight of the luma equation (e.g. 0.2126 for BT.709)
+ * @kb: Blue weight of the luma equation (e.g. 0.0722 for BT.709)
+ * @full_range: TRUE for 0-255 output, FALSE for 16-235/16-240
+ *
+ * Derives the fixed-point coefficients frame_write_rect() uses to turn
+ * 8-bit RGB into YUV of the given colorimetry.
+ */
+void frame_yuv_matrix_init(FrameYuvMatrix *matrix, gdouble kr, gdouble kb,
+                           gboolean full_range) {
+    const gdouble one = (gdouble)(1 << FRAME_YUV_SHIFT);
+    const gdouble kg = 1.0 - kr - kb;
+    const gdouble y_scale = full_range ? 1.0 : 219.0 / 255.0;
+    const gdouble c_scale = full_range ? 1.0 : 224.0 / 255.0;
+    const gdouble cb = c_scale / (2.0 * (1.0 - kb));
+    const gdouble cr = c_scale / (2.0 * (1.0 - kr));
+
+    matrix->y[0] = (gint16)(kb * y_scale * one + 0.5);
+    matrix->y[1] = (gint16)(kg * y_scale * one + 0.5);
+    matrix->y[2] = (gint16)(kr * y_scale * one + 0.5);
+
+    // Cb = (B - Y) / (2 (1 - Kb)), Cr = (R - Y) / (2 (1 - Kr))
+    matrix->u[0] = (gint16)((1.0 - kb) * cb * one + 0.5);
+    matrix->u[1] = (gint16)(-kg * cb * one - 0.5);
+    matrix->u[2] = (gint16)(-kr * cb * one - 0.5);
+
+    matrix->v[0] = (gint16)(-kb * cr * one - 0.5);
+    matrix->v[1] = (gint16)(-kg * cr * one - 0.5);
+    matrix->v[2] = (gint16)((1.0 - kr) * cr * one + 0.5);
+
+    matrix->y_offset = full_range ? 0 : 16;
+}
+
+static inline guint8 frame_clamp_u8(gint value) {
+    return (guint8)CLAMP(value, 0, 255);
+}
+
+/**
+ * frame_y_row_c:
+ * @dst: First luma sample to write
+ * @src: First BGRA pixel to read
+ * @n: Number of pixels
+ * @matrix: Conversion coefficients
+ *
+ * Portable luma kernel, also used for the tails of the SIMD kernels.
+ */
+static void frame_y_row_c(guint8 *dst, const guint8 *src, gint n,
+                          const FrameYuvMatrix *matrix) {
+    for (gint i = 0; i < n; i++, src += FRAME_BYTES_PER_PIXEL) {
+        gint y = (matrix->y[0] * src[0] + matrix->y[1] * src[1] +
+                  matrix->y[2] * src[2] + FRAME_YUV_ROUND) >> FRAME_YUV_SHIFT;
+        dst[i] = frame_clamp_u8(y + matrix->y_offset);
+    }
+}
+
+/**
+ * frame_uv_row_c:
+ * @u: First Cb sample to write
+ * @v: First Cr sample to write
+ * @step: Distance between samples, 1 for planar and 2 for interleaved
+ * @row0: First BGRA pixel of the upper row of the 2x2 blocks
+ * @row1: First BGRA pixel of the lower row (may equal @row0)
+ * @n: Number of pixels; an odd last pixel forms a block on its own
+ * @matrix: Conversion coefficients
+ *
+ * Portable chroma kernel. Each sample is computed from the average of a
+ * 2x2 block, also used for the tails of the SIMD kernels.
+ */
+static void frame_uv_row_c(guint8 *u, guint8 *v, gint step,
+                           const guint8 *row0, const guint8 *row1, gint n,
+                           const FrameYuvMatrix *matrix) {
+    for (gint i = 0; i < n; i += 2) {
+        const gint next = i + 1 < n ? FRAME_BYTES_PER_PIXEL : 0;
+        gint sum[3];
+
+        for (gint c = 0; c < 3; c++) {
+            sum[c] = row0[c] + row0[next + c] + row1[c] + row1[next + c];
+        }
+
+        gint cb = (matrix->u[0] * sum[0] + matrix->u[1] * sum[1] +
+                   matrix->u[2] * sum[2] + FRAME_UV_ROUND) >> FRAME_UV_SHIFT;
+        gint cr = (matrix->v[0] * sum[0] + matrix->v[1] * sum[1] +
+                   matrix->v[2] * sum[2] + FRAME_UV_ROUND) >> FRAME_UV_SHIFT;
+        *u = frame_clamp_u8(cb + 128);
+        *v = frame_clamp_u8(cr + 128);
+
+        u += step;
+        v += step;
+        row0 += 2 * FRAME_BYTES_PER_PIXEL;
+        row1 += 2 * FRAME_BYTES_PER_PIXEL;
+    }
+}
+
+/**
+ * frame_unpremultiply_row_c:
+ * @dst: First BGRA pixel to write
+ * @src: First premultiplied BGRA pixel to read
+ * @n: Number of pixels
+ *
+ * Portable un-premultiply kernel, also used for the tails of the SIMD
+ * kernels. Fully transparent pixels become transparent black.
+ */
+static void frame_unpremultiply_row_c(guint8 *dst, const guint8 *src, gint n) {
+    for (gint i = 0; i < n; i++, src += FRAME_BYTES_PER_PIXEL, dst += FRAME_BYTES_PER_PIXEL) {
+        const guint8 a = src[3];
+
+        if (a == 255) {
+            memcpy(dst, src, FRAME_BYTES_PER_PIXEL);
+            continue;
+        }
+
+        const gfloat scale = a ? 255.0f / a : 0.0f;
+        for (gint c = 0; c < 3; c++) {
+            dst[c] = (guint8)MIN((gint)(src[c] * scale + 0.5f), 255);
+        }
+        dst[3] = a;
+    }
+}
+
+#ifdef FRAME_HAVE_AVX2
+/**
+ * frame_y_row_avx2:
+ *
+ * AVX2 variant of frame_y_row_c(), eight pixels per iteration.
+ */
+__attribute__((target("avx2")))
+static void frame_y_row_avx2(guint8 *dst, const guint8 *src, gint n,
+                             const FrameYuvMatrix *matrix) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i coef = _mm256_setr_epi16(
+        matrix->y[0], matrix->y[1], matrix->y[2], 0, matrix->y[0], matrix->y[1], matrix->y[2], 0,
+        matrix->y[0], matrix->y[1], matrix->y[2], 0, matrix->y[0], matrix->y[1], matrix->y[2], 0);
+    const __m256i round = _mm256_set1_epi32(FRAME_YUV_ROUND);
+    const __m256i offset = _mm256_set1_epi32(matrix->y_offset);
+    const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    gint i = 0;
+
+    for (; i + 8 <= n; i += 8, src += 8 * FRAME_BYTES_PER_PIXEL) {
+        __m256i px = _mm256_loadu_si256((const __m256i *)src);
+
+        // Pixels 0,1,4,5 and 2,3,6,7 widened to 16 bits
+        __m256i lo = _mm256_madd_epi16(_mm256_unpacklo_epi8(px, zero), coef);
+        __m256i hi = _mm256_madd_epi16(_mm256_unpackhi_epi8(px, zero), coef);
+
+        // B*cb+G*cg and R*cr pairs summed into pixels 0-3 | 4-7
+        __m256i y = _mm256_hadd_epi32(lo, hi);
+        y = _mm256_add_epi32(_mm256_srai_epi32(_mm256_add_epi32(y, round), FRAME_YUV_SHIFT), offset);
+
+        y = _mm256_packs_epi32(y, y);
+        y = _mm256_packus_epi16(y, y);
+        y = _mm256_permutevar8x32_epi32(y, order);
+        _mm_storel_epi64((__m128i *)(dst + i), _mm256_castsi256_si128(y));
+    }
+
+    frame_y_row_c(dst + i, src, n - i, matrix);
+}
+
+/**
+ * frame_uv_row_avx2:
+ *
+ * AVX2 variant of frame_uv_row_c(), four 2x2 blocks per iteration.
+ */
+__attribute__((target("avx2")))
+static void frame_uv_row_avx2(guint8 *u, guint8 *v, gint step,
+                              const guint8 *row0, const guint8 *row1, gint n,
+                              const FrameYuvMatrix *matrix) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i coef_u = _mm256_setr_epi16(
+        matrix->u[0], matrix->u[1], matrix->u[2], 0, matrix->u[0], matrix->u[1], matrix->u[2], 0,
+        matrix->u[0], matrix->u[1], matrix->u[2], 0, matrix->u[0], matrix->u[1], matrix->u[2], 0);
+    const __m256i coef_v = _mm256_setr_epi16(
+        matrix->v[0], matrix->v[1], matrix->v[2], 0, matrix->v[0], matrix->v[1], matrix->v[2], 0,
+        matrix->v[0], matrix->v[1], matrix->v[2], 0, matrix->v[0], matrix->v[1], matrix->v[2], 0);
+    const __m256i round = _mm256_set1_epi32(FRAME_UV_ROUND);
+    const __m256i offset = _mm256_set1_epi32(128);
+    gint i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(row0 + i * FRAME_BYTES_PER_PIXEL));
+        __m256i b = _mm256_loadu_si256((const __m256i *)(row1 + i * FRAME_BYTES_PER_PIXEL));
+
+        // Vertical sums of pixels 0,1,4,5 and 2,3,6,7
+        __m256i lo = _mm256_add_epi16(_mm256_unpacklo_epi8(a, zero), _mm256_unpacklo_epi8(b, zero));
+        __m256i hi = _mm256_add_epi16(_mm256_unpackhi_epi8(a, zero), _mm256_unpackhi_epi8(b, zero));
+
+        // Horizontal pair sums, giving blocks 0,1 | 2,3
+        lo = _mm256_add_epi16(lo, _mm256_srli_si256(lo, 8));
+        hi = _mm256_add_epi16(hi, _mm256_srli_si256(hi, 8));
+        __m256i blocks = _mm256_unpacklo_epi64(lo, hi);
+
+        // Cb0 Cb1 Cr0 Cr1 | Cb2 Cb3 Cr2 Cr3
+        __m256i uv = _mm256_hadd_epi32(_mm256_madd_epi16(blocks, coef_u),
+                                       _mm256_madd_epi16(blocks, coef_v));
+        uv = _mm256_add_epi32(_mm256_srai_epi32(_mm256_add_epi32(uv, round), FRAME_UV_SHIFT), offset);
+        uv = _mm256_packs_epi32(uv, uv);
+        uv = _mm256_packus_epi16(uv, uv);
+
+        guint32 first = (guint32)_mm256_extract_epi32(uv, 0);
+        guint32 second = (guint32)_mm256_extract_epi32(uv, 4);
+        guint8 *cb = u + (i / 2) * step;
+        guint8 *cr = v + (i / 2) * step;
+        cb[0] = (guint8)first;
+        cb[step] = (guint8)(first >> 8);
+        cb[2 * step] = (guint8)second;
+        cb[3 * step] = (guint8)(second >> 8);
+        cr[0] = (guint8)(first >> 16);
+        cr[step] = (guint8)(first >> 24);
+        cr[2 * step] = (guint8)(second >> 16);
+        cr[3 * step] = (guint8)(second >> 24);
+    }
+
+    frame_uv_row_c(u + (i / 2) * step, v + (i / 2) * step, step,
+                   row0 + i * FRAME_BYTES_PER_PIXEL, row1 + i * FRAME_BYTES_PER_PIXEL,
+                   n - i, matrix);
+}
+
+/**
+ * frame_unpremultiply_row_avx2:
+ *
+ * AVX2 variant of frame_unpremultiply_row_c(), eight pixels per
+ * iteration. Runs of opaque pixels are copied as they are.
+ */
+__attribute__((target("avx2")))
+static void frame_unpremultiply_row_avx2(guint8 *dst, const guint8 *src, gint n) {
+    const __m256i alpha_mask = _mm256_set1_epi32((gint)0xff000000);
+    const __m256 max = _mm256_set1_ps(255.0f);
+    const __m256 half = _mm256_set1_ps(0.5f);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    gint i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        const guint8 *in = src + i * FRAME_BYTES_PER_PIXEL;
+        __m256i px = _mm256_loadu_si256((const __m256i *)in);
+
+        if (_mm256_movemask_epi8(_mm256_cmpeq_epi32(_mm256_and_si256(px, alpha_mask), alpha_mask)) == -1) {
+            _mm256_storeu_si256((__m256i *)(dst + i * FRAME_BYTES_PER_PIXEL), px);
+            continue;
+        }
+
+        // Two pixels per vector, one per lane: B G R A as floats
+        __m256i out[4];
+        for (gint k = 0; k < 4; k++) {
+            __m256i wide = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(in + 8 * k)));
+            __m256 c = _mm256_cvtepi32_ps(wide);
+            __m256 a = _mm256_permute_ps(c, _MM_SHUFFLE(3, 3, 3, 3));
+            __m256 scale = _mm256_div_ps(max, a);
+            scale = _mm256_blendv_ps(scale, zero, _mm256_cmp_ps(a, zero, _CMP_EQ_OQ));
+
+            __m256 r = _mm256_min_ps(_mm256_add_ps(_mm256_mul_ps(c, scale), half), max);
+            r = _mm256_blend_ps(r, c, 0x88);
+            out[k] = _mm256_cvttps_epi32(r);
+        }
+
+        // Pixels 0,2,4,6 | 1,3,5,7 after packing, then back in order
+        __m256i packed = _mm256_packus_epi16(_mm256_packus_epi32(out[0], out[1]),
+                                             _mm256_packus_epi32(out[2], out[3]));
+        packed = _mm256_permutevar8x32_epi32(packed, order);
+        _mm256_storeu_si256((__m256i *)(dst + i * FRAME_BYTES_PER_PIXEL), packed);
+    }
+
+    frame_unpremultiply_row_c(dst + i * FRAME_BYTES_PER_PIXEL, src + i * FRAME_BYTES_PER_PIXEL, n - i);
+}
+#endif
+
+#ifdef FRAME_HAVE_NEON
+/**
+ * frame_y_row_neon:
+ *
+ * NEON variant of frame_y_row_c(), eight pixels per iteration.
+ */
+static void frame_y_row_neon(guint8 *dst, const guint8 *src, gint n,
+                             const FrameYuvMatrix *matrix) {
+    const int16x8_t offset = vdupq_n_s16(matrix->y_offset);
+    gint i = 0;
+
+    for (; i + 8 <= n; i += 8, src += 8 * FRAME_BYTES_PER_PIXEL) {
+        uint8x8x4_t px = vld4_u8(src);
+        int16x8_t b = vreinterpretq_s16_u16(vmovl_u8(px.val[0]));
+        int16x8_t g = vreinterpretq_s16_u16(vmovl_u8(px.val[1]));
+        int16x8_t r = vreinterpretq_s16_u16(vmovl_u8(px.val[2]));
+
+        int32x4_t lo = vmull_n_s16(vget_low_s16(b), matrix->y[0]);
+        lo = vmlal_n_s16(lo, vget_low_s16(g), matrix->y[1]);
+        lo = vmlal_n_s16(lo, vget_low_s16(r), matrix->y[2]);
+        int32x4_t hi = vmull_n_s16(vget_high_s16(b), matrix->y[0]);
+        hi = vmlal_n_s16(hi, vget_high_s16(g), matrix->y[1]);
+        hi = vmlal_n_s16(hi, vget_high_s16(r), matrix->y[2]);
+
+        int16x8_t y = vcombine_s16(vrshrn_n_s32(lo, FRAME_YUV_SHIFT),
+                                   vrshrn_n_s32(hi, FRAME_YUV_SHIFT));
+        vst1_u8(dst + i, vqmovun_s16(vaddq_s16(y, offset)));
+    }
+
+    frame_y_row_c(dst + i, src, n - i, matrix);
+}
+
+/**
+ * frame_uv_row_neon:
+ *
+ * NEON variant of frame_uv_row_c(), four 2x2 blocks per iteration.
+ */
+static void frame_uv_row_neon(guint8 *u, guint8 *v, gint step,
+                              const guint8 *row0, const guint8 *row1, gint n,
+                              const FrameYuvMatrix *matrix) {
+    const int16x4_t offset = vdup_n_s16(128);
+    gint i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        uint8x8x4_t a = vld4_u8(row0 + i * FRAME_BYTES_PER_PIXEL);
+        uint8x8x4_t b = vld4_u8(row1 + i * FRAME_BYTES_PER_PIXEL);
+        int16x4_t sum[3];
+
+        // Vertical sums, then horizontal pair sums of each 2x2 block
+        for (gint c = 0; c < 3; c++) {
+            uint16x8_t col = vaddl_u8(a.val[c], b.val[c]);
+            sum[c] = vreinterpret_s16_u16(vpadd_u16(vget_low_u16(col), vget_high_u16(col)));
+        }
+
+        int32x4_t cb = vmull_n_s16(sum[0], matrix->u[0]);
+        cb = vmlal_n_s16(cb, sum[1], matrix->u[1]);
+        cb = vmlal_n_s16(cb, sum[2], matrix->u[2]);
+        int32x4_t cr = vmull_n_s16(sum[0], matrix->v[0]);
+        cr = vmlal_n_s16(cr, sum[1], matrix->v[1]);
+        cr = vmlal_n_s16(cr, sum[2], matrix->v[2]);
+
+        uint8x8_t uv = vqmovun_s16(vcombine_s16(
+            vadd_s16(vrshrn_n_s32(cb, FRAME_UV_SHIFT), offset),
+            vadd_s16(vrshrn_n_s32(cr, FRAME_UV_SHIFT), offset)));
+
+        guint8 out[8];
+        vst1_u8(out, uv);
+        for (gint k = 0; k < 4; k++) {
+            u[(i / 2 + k) * step] = out[k];
+            v[(i / 2 + k) * step] = out[4 + k];
+        }
+    }
+
+    frame_uv_row_c(u + (i / 2) * step, v + (i / 2) * step, step,
+                   row0 + i * FRAME_BYTES_PER_PIXEL, row1 + i * FRAME_BYTES_PER_PIXEL,
+                   n - i, matrix);
+}
+
+/**
+ * frame_unpremultiply_row_neon:
+ *
+ * NEON variant of frame_unpremultiply_row_c(), eight pixels per
+ * iteration. Runs of opaque pixels are copied as they are.
+ */
+static void frame_unpremultiply_row_neon(guint8 *dst, const guint8 *src, gint n) {
+    const float32x4_t max = vdupq_n_f32(255.0f);
+    const float32x4_t half = vdupq_n_f32(0.5f);
+    gint i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        const guint8 *in = src + i * FRAME_BYTES_PER_PIXEL;
+        uint8x8x4_t px = vld4_u8(in);
+
+        if (vminv_u8(px.val[3]) == 255) {
+            vst4_u8(dst + i * FRAME_BYTES_PER_PIXEL, px);
+            continue;
+        }
+
+        uint16x8_t a16 = vmovl_u8(px.val[3]);
+        float32x4_t a_lo = vcvtq_f32_u32(vmovl_u16(vget_low_u16(a16)));
+        float32x4_t a_hi = vcvtq_f32_u32(vmovl_u16(vget_high_u16(a16)));
+        float32x4_t scale_lo = vbslq_f32(vceqzq_f32(a_lo), vdupq_n_f32(0.0f), vdivq_f32(max, a_lo));
+        float32x4_t scale_hi = vbslq_f32(vceqzq_f32(a_hi), vdupq_n_f32(0.0f), vdivq_f32(max, a_hi));
+
+        for (gint c = 0; c < 3; c++) {
+            uint16x8_t c16 = vmovl_u8(px.val[c]);
+            float32x4_t lo = vcvtq_f32_u32(vmovl_u16(vget_low_u16(c16)));
+            float32x4_t hi = vcvtq_f32_u32(vmovl_u16(vget_high_u16(c16)));
+            lo = vminq_f32(vmlaq_f32(half, lo, scale_lo), max);
+            hi = vminq_f32(vmlaq_f32(half, hi, scale_hi), max);
+            px.val[c] = vmovn_u16(vcombine_u16(vmovn_u32(vcvtq_u32_f32(lo)),
+                                               vmovn_u32(vcvtq_u32_f32(hi))));
+        }
+
+        vst4_u8(dst + i * FRAME_BYTES_PER_PIXEL, px);
+    }
+
+    frame_unpremultiply_row_c(dst + i * FRAME_BYTES_PER_PIXEL, src + i * FRAME_BYTES_PER_PIXEL, n - i);
+}
+#endif
+
+typedef struct {
+    const gchar *name;
+    FramePixelRowFunc unpremultiply_row;
+    FrameYRowFunc y_row;
+    FrameUvRowFunc uv_row;
+} FrameKernels;
+
+/**
+ * frame_get_kernels:
+ *
+ * Picks the fastest conversion kernels the CPU supports, once per process.
+ *
+ * Returns: The selected kernels
+ */
+static const FrameKernels *frame_get_kernels(void) {
+    static FrameKernels kernels = {
+        "c", frame_unpremultiply_row_c, frame_y_row_c, frame_uv_row_c
+    };
+    static gsize initialized = 0;
+
+    if (g_once_init_enter(&initialized)) {
+#if defined(FRAME_HAVE_AVX2)
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            kernels.name = "avx2";
+            kernels.unpremultiply_row = frame_unpremultiply_row_avx2;
+            kernels.y_row = frame_y_row_avx2;
+            kernels.uv_row = frame_uv_row_avx2;
+        }
+#elif defined(FRAME_HAVE_NEON)
+        kernels.name = "neon";
+        kernels.unpremultiply_row = frame_unpremultiply_row_neon;
+        kernels.y_row = frame_y_row_neon;
+        kernels.uv_row = frame_uv_row_neon;
+#endif
+        g_once_init_leave(&initialized, 1);
+    }
+
+    return &kernels;
+}
+
+/**
+ * frame_convert_backend:
+ *
+ * Returns: Name of the kernels used for conversions ("avx2", "neon" or "c")
+ */
+const gchar *frame_convert_backend(void) {
+    return frame_get_kernels()->name;
+}
+
+/**
+ * frame_unpremultiply_rect:
+ * @dst: Destination frame (first pixel of the plane)
+ * @dst_stride: Destination stride in bytes
+ * @src: Source frame with premultiplied alpha (first pixel of the plane)
+ * @src_stride: Source stride in bytes
+ * @rect: The already clipped rectangle to convert
+ *
+ * Copies one rectangle between two BGRA frames of equal size, dividing
+ * the color channels by alpha on the way so @dst holds straight alpha.
+ *
+ * Returns: Number of bytes written
+ */
+gsize frame_unpremultiply_rect(guint8 *dst, gint dst_stride,
+                               const guint8 *src, gint src_stride,
+                               const FrameRect *rect) {
+    const FrameKernels *kernels = frame_get_kernels();
+    gsize offset_dst = (gsize)rect->y * dst_stride + (gsize)rect->x * FRAME_BYTES_PER_PIXEL;
+    gsize offset_src = (gsize)rect->y * src_stride + (gsize)rect->x * FRAME_BYTES_PER_PIXEL;
+
+    for (gint y = 0; y < rect->height; y++) {
+        kernels->unpremultiply_row(dst + offset_dst + (gsize)y * dst_stride,
+                                   src + offset_src + (gsize)y * src_stride, rect->width);
+    }
+
+    return (gsize)rect->width * FRAME_BYTES_PER_PIXEL * rect->height;
+}
+
+/**
+ * frame_write_rect:
+ * @format: Layout of @dst
+ * @dst: Planes of the mapped output frame
+ * @src: Source BGRA frame (first pixel)
+ * @src_stride: Source stride in bytes
+ * @rect: The already clipped rectangle to write
+ * @width: Frame width in pixels
+ * @height: Frame height in pixels
+ * @matrix: Conversion coefficients, unused for BGRA
+ *
+ * Writes one rectangle of a CEF paint into an output frame, converting
+ * to YUV on the way so the source is read exactly once. For subsampled
+ * formats the rectangle is grown to even coordinates first, so every
+ * chroma sample it touches is computed from its complete 2x2 block.
+ *
+ * Returns: Number of bytes written
+ */
+gsize frame_write_rect(FrameFormat format, const FramePlanes *dst,
+                       const guint8 *src, gint src_stride,
+                       const FrameRect *rect, gint width, gint height,
+                       const FrameYuvMatrix *matrix) {
+    if (format == FRAME_FORMAT_BGRA) {
+        return frame_copy_rect(dst->data[0], dst->stride[0], src, src_stride, rect);
+    }
+    if (format == FRAME_FORMAT_BGRA_STRAIGHT) {
+        return frame_unpremultiply_rect(dst->data[0], dst->stride[0], src, src_stride, rect);
+    }
+
+    const FrameKernels *kernels = frame_get_kernels();
+    const gint x0 = rect->x & ~1;
+    const gint y0 = rect->y & ~1;
+    const gint x1 = MIN((rect->x + rect->width + 1) & ~1, width);
+    const gint y1 = MIN((rect->y + rect->height + 1) & ~1, height);
+    const gint n = x1 - x0;
+    const gint chroma = (n + 1) / 2;
+    guint8 *u, *v;
+    gint u_stride, v_stride, step;
+    gsize written = 0;
+
+    if (format == FRAME_FORMAT_NV12) {
+        u = dst->data[1] + x0;
+        v = u + 1;
+        u_stride = v_stride = dst->stride[1];
+        step = 2;
+    } else {
+        u = dst->data[1] + x0 / 2;
+        v = dst->data[2] + x0 / 2;
+        u_stride = dst->stride[1];
+        v_stride = dst->stride[2];
+        step = 1;
+    }
+
+    for (gint y = y0; y < y1; y += 2) {
+        const guint8 *row0 = src + (gsize)y * src_stride + (gsize)x0 * FRAME_BYTES_PER_PIXEL;
+        const guint8 *row1 = y + 1 < y1 ? row0 + src_stride : row0;
+        const gsize line = (gsize)(y / 2);
+
+        // Both luma rows and the chroma row of a block row in one pass
+        kernels->y_row(dst->data[0] + (gsize)y * dst->stride[0] + x0, row0, n, matrix);
+        if (row1 != row0) {
+            kernels->y_row(dst->data[0] + (gsize)(y + 1) * dst->stride[0] + x0, row1, n, matrix);
+        }
+
+        kernels->uv_row(u + line * u_stride, v + line * v_stride, step,
+                        row0, row1, n, matrix);
+        written += (gsize)n * (row1 != row0 ? 2 : 1) + 2 * chroma;
+    }
+
+    return written;
+}
@@ -0,0 +1,55 @@
+#ifndef __FRAME_UTILS_H__
+#define __FRAME_UTILS_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct {
+    gint x;
+    gint y;
+    gint width;
+    gint height;
+} FrameRect;
+
+/* Output layouts a CEF paint can be written into */
+typedef enum {
+    FRAME_FORMAT_BGRA,
+    FRAME_FORMAT_BGRA_STRAIGHT,
+    FRAME_FORMAT_I420,
+    FRAME_FORMAT_NV12
+} FrameFormat;
+
+/* Plane pointers and strides of a mapped output frame */
+typedef struct {
+    guint8 *data[3];
+    gint stride[3];
+} FramePlanes;
+
+/* Fixed-point RGB to YUV coefficients, in B, G, R order */
+typedef struct {
+    gint16 y[3];
+    gint16 u[3];
+    gint16 v[3];
+    gint16 y_offset;
+} FrameYuvMatrix;
+
+gboolean frame_rect_clip(FrameRect *rect, gint width, gint height);
+gsize frame_copy_rect(guint8 *dst, gint dst_stride,
+                      const guint8 *src, gint src_stride,
+                      const FrameRect *rect);
+gsize frame_unpremultiply_rect(guint8 *dst, gint dst_stride,
+                               const guint8 *src, gint src_stride,
+                               const FrameRect *rect);
+
+void frame_yuv_matrix_init(FrameYuvMatrix *matrix, gdouble kr, gdouble kb,
+                           gboolean full_range);
+gsize frame_write_rect(FrameFormat format, const FramePlanes *dst,
+                       const guint8 *src, gint src_stride,
+                       const FrameRect *rect, gint width, gint height,
+                       const FrameYuvMatrix *matrix);
+const gchar *frame_convert_backend(void);
+
+G_END_DECLS
+
+#endif
@@ -1,20 +1,45 @@
 #include "gstchromiumsrc.h"
 #include "cef_render_handler.h"
+#include "chromium_tracer.h"
 #include "debug_utils.h"
+#include "memfd_allocator.h"
 
-#include <gst/app/gstappsrc.h>
+#include <gst/base/gstpushsrc.h>
 #include <gst/gst.h>
+#include <gst/video/gstvideopool.h>
 
 GST_DEBUG_CATEGORY_STATIC(chromium_src_debug);
 #define GST_CAT_DEFAULT chromium_src_debug
 
+/* Highest output rate; begin frames are sent by us, so CEF's own
+ * 60 fps windowless limit does not apply */
+#define CHROMIUM_SRC_MAX_FPS 240
+
+/* Buffers kept in flight: one being painted, one pending, the last pushed
+ * frame kept for duplication, and one downstream */
+#define CHROMIUM_SRC_MIN_BUFFERS 4
+
 enum {
     PROP_0,
     PROP_URL,
     PROP_WIDTH,
     PROP_HEIGHT,
     PROP_FRAMERATE,
-    PROP_GPU
+    PROP_GPU,
+    PROP_DIRTY_RECTS,
+    PROP_INVALIDATE,
+    PROP_KEEP_BROWSER,
+    PROP_ALPHA_MODE,
+    PROP_READY_MODE,
+    PROP_READY_TIMEOUT,
+    PROP_FRAME_SYNC,
+    PROP_IS_LIVE,
+    PROP_OUTPUT_MEMORY,
+    PROP_PAINT_COUNT,
+    PROP_BYTES_COPIED,
+    PROP_FRAMES_DUPLICATED,
+    PROP_FRAMES_DROPPED,
+    PROP_STATS
 };
 
 static GstStaticPadTemplate src_template = GST_STATIC_PAD_TEMPLATE(
@@ -23,15 +48,101 @@ static GstStaticPadTemplate src_template = GST_STATIC_PAD_TEMPLATE(
     GST_PAD_ALWAYS,
     GST_STATIC_CAPS(
         "video/x-raw, "
-        "format = (string) BGRA, "
+        "format = (string) { BGRA, BGRx, I420, NV12 }, "
         "width = (int) [ 1, MAX ], "
         "height = (int) [ 1, MAX ], "
         "framerate = (fraction) [ 0/1, MAX ]"
     )
 );
 
+/* References of the capture timestamps attached to every buffer */
+static GstCaps *begin_frame_caps = NULL;
+static GstCaps *paint_caps = NULL;
+
+/**
+ * gst_chromium_src_alpha_mode_get_type:
+ *
+ * Registers the GstChromiumSrcAlphaMode enum used by the alpha-mode
+ * property.
+ *
+ * Returns: The GType of GstChromiumSrcAlphaMode
+ */
+GType gst_chromium_src_alpha_mode_get_type(void) {
+    static gsize type = 0;
+    static const GEnumValue values[] = {
+        { GST_CHROMIUM_SRC_ALPHA_PREMULTIPLIED,
+          "BGRA with premultiplied alpha, as painted by Chromium", "premultiplied" },
+        { GST_CHROMIUM_SRC_ALPHA_STRAIGHT,
+          "BGRA with straight alpha on a transparent page background", "straight" },
+        { GST_CHROMIUM_SRC_ALPHA_OPAQUE,
+          "BGRx without alpha", "opaque" },
+        { 0, NULL, NULL }
+    };
+
+    if (g_once_init_enter(&type)) {
+        GType id = g_enum_register_static("GstChromiumSrcAlphaMode", values);
+        g_once_init_leave(&type, id);
+    }
+
+    return (GType)type;
+}
+
+/**
+ * gst_chromium_src_ready_mode_get_type:
+ *
+ * Registers the GstChromiumSrcReadyMode enum used by the ready-mode
+ * property.
+ *
+ * Returns: The GType of GstChromiumSrcReadyMode
+ */
+GType gst_chromium_src_ready_mode_get_type(void) {
+    static gsize type = 0;
+    static const GEnumValue values[] = {
+        { GST_CHROMIUM_SRC_READY_NONE,
+          "Output whatever was painted first", "none" },
+        { GST_CHROMIUM_SRC_READY_LOAD,
+          "Wait until the main frame finished loading", "load" },
+        { GST_CHROMIUM_SRC_READY_SIGNAL,
+          "Wait until the page calls window.chromiumsrc.ready()", "signal" },
+        { 0, NULL, NULL }
+    };
+
+    if (g_once_init_enter(&type)) {
+        GType id = g_enum_register_static("GstChromiumSrcReadyMode", values);
+        g_once_init_leave(&type, id);
+    }
+
+    return (GType)type;
+}
+
+/**
+ * gst_chromium_src_output_memory_get_type:
+ *
+ * Registers the GstChromiumSrcOutputMemory enum used by the
+ * output-memory property.
+ *
+ * Returns: The GType of GstChromiumSrcOutputMemory
+ */
+GType gst_chromium_src_output_memory_get_type(void) {
+    static gsize type = 0;
+    static const GEnumValue values[] = {
+        { GST_CHROMIUM_SRC_MEMORY_SYSTEM,
+          "System memory, or the pool offered downstream", "system" },
+        { GST_CHROMIUM_SRC_MEMORY_MEMFD,
+          "Sealed memfd backed GstFdMemory for passing frames between processes", "memfd" },
+        { 0, NULL, NULL }
+    };
+
+    if (g_once_init_enter(&type)) {
+        GType id = g_enum_register_static("GstChromiumSrcOutputMemory", values);
+        g_once_init_leave(&type, id);
+    }
+
+    return (GType)type;
+}
+
 #define gst_chromium_src_parent_class parent_class
-G_DEFINE_TYPE(GstChromiumSrc, gst_chromium_src, GST_TYPE_BIN);
+G_DEFINE_TYPE(GstChromiumSrc, gst_chromium_src, GST_TYPE_PUSH_SRC);
 
 static void gst_chromium_src_set_property(
 	GObject *object,
@@ -43,16 +154,22 @@ static void gst_chromium_src_get_property(
 	guint prop_id,
     GValue *value, GParamSpec *pspec);
 static void gst_chromium_src_finalize(GObject *object);
-
-static GstStateChangeReturn gst_chromium_src_change_state(
-    GstElement *element,
-	GstStateChange transition);
-
-static void gst_chromium_src_need_data(
-	GstAppSrc *appsrc,
-	guint length,
-    gpointer user_data);
-static void gst_chromium_src_enough_data(GstAppSrc *appsrc, gpointer user_data);
+static void gst_chromium_src_reset_stats(GstChromiumSrc *src);
+static GstClockTime gst_chromium_src_slot_time(GstChromiumSrc *src, guint64 index);
+static GstStateChangeReturn gst_chromium_src_change_state(GstElement *element,
+    GstStateChange transition);
+
+static gboolean gst_chromium_src_start(GstBaseSrc *basesrc);
+static gboolean gst_chromium_src_stop(GstBaseSrc *basesrc);
+static gboolean gst_chromium_src_negotiate(GstBaseSrc *basesrc);
+static gboolean gst_chromium_src_set_caps(GstBaseSrc *basesrc, GstCaps *caps);
+static gboolean gst_chromium_src_decide_allocation(GstBaseSrc *basesrc, GstQuery *query);
+static gboolean gst_chromium_src_query(GstBaseSrc *basesrc, GstQuery *query);
+static gboolean gst_chromium_src_unlock(GstBaseSrc *basesrc);
+static gboolean gst_chromium_src_unlock_stop(GstBaseSrc *basesrc);
+static gboolean gst_chromium_src_is_seekable(GstBaseSrc *basesrc);
+static gboolean gst_chromium_src_do_seek(GstBaseSrc *basesrc, GstSegment *segment);
+static GstFlowReturn gst_chromium_src_create(GstPushSrc *pushsrc, GstBuffer **outbuf);
 
 /**
  * gst_chromium_src_class_init:
@@ -67,6 +184,8 @@ static void gst_chromium_src_enough_data(GstAppSrc *appsrc, gpointer user_data);
 static void gst_chromium_src_class_init(GstChromiumSrcClass *klass) {
     GObjectClass *gobject_class = G_OBJECT_CLASS(klass);
     GstElementClass *gstelement_class = GST_ELEMENT_CLASS(klass);
+    GstBaseSrcClass *gstbasesrc_class = GST_BASE_SRC_CLASS(klass);
+    GstPushSrcClass *gstpushsrc_class = GST_PUSH_SRC_CLASS(klass);
 
     GST_DEBUG_CATEGORY_INIT(chromium_src_debug, "chromiumsrc", 0, "Chromium Source");
 
@@ -76,26 +195,30 @@ static void gst_chromium_src_class_init(GstChromiumSrcClass *klass) {
 
     g_object_class_install_property(gobject_class, PROP_URL,
         g_param_spec_string("url", "URL",
-            "URL to render in the browser",
+            "URL to render in the browser; changing it on a running browser navigates "
+            "and holds the last frame until the new page painted",
             "https://example.com/test.html",
             static_cast<GParamFlags>(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
 
     g_object_class_install_property(gobject_class, PROP_WIDTH,
         g_param_spec_int("width", "Width",
-            "Video width in pixels",
+            "Preferred video width in pixels; downstream caps may pick another, "
+            "changing it while playing resizes the page and renegotiates",
             1, G_MAXINT, 1920,
             static_cast<GParamFlags>(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
 
     g_object_class_install_property(gobject_class, PROP_HEIGHT,
         g_param_spec_int("height", "Height",
-            "Video height in pixels",
+            "Preferred video height in pixels; downstream caps may pick another, "
+            "changing it while playing resizes the page and renegotiates",
             1, G_MAXINT, 1080,
             static_cast<GParamFlags>(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
 
     g_object_class_install_property(gobject_class, PROP_FRAMERATE,
-        g_param_spec_string("framerate", "Framerate",
-            "Output framerate in frames per second (e.g., 30)",
-            "30",
+        gst_param_spec_fraction("framerate", "Framerate",
+            "Output framerate as a fraction (e.g., 30/1, 30000/1001, 120/1); changing it "
+            "while playing renegotiates",
+            1, 1, CHROMIUM_SRC_MAX_FPS, 1, 30, 1,
             static_cast<GParamFlags>(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
 
     g_object_class_install_property(gobject_class, PROP_GPU,
@@ -104,6 +227,100 @@ static void gst_chromium_src_class_init(GstChromiumSrcClass *klass) {
             "auto",
             static_cast<GParamFlags>(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
 
+    g_object_class_install_property(gobject_class, PROP_DIRTY_RECTS,
+        g_param_spec_boolean("dirty-rects", "Dirty rects",
+            "Only copy the regions Chromium repainted into recycled buffers; only safe "
+            "when nothing downstream draws into buffers in place (e.g. timeoverlay, "
+            "textoverlay), which would leave artifacts where the page did not repaint",
+            FALSE,
+            static_cast<GParamFlags>(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+    g_object_class_install_property(gobject_class, PROP_INVALIDATE,
+        g_param_spec_boolean("invalidate", "Invalidate",
+            "Force Chromium to repaint the whole view every frame; when false only "
+            "changed content is painted and static pages repeat the previous frame",
+            TRUE,
+            static_cast<GParamFlags>(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+    g_object_class_install_property(gobject_class, PROP_KEEP_BROWSER,
+        g_param_spec_boolean("keep-browser", "Keep browser",
+            "Load the page in NULL to READY and keep the browser, its JS heap and caches "
+            "across PAUSED/READY cycles; when false it is created and closed with streaming",
+            TRUE,
+            static_cast<GParamFlags>(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+    g_object_class_install_property(gobject_class, PROP_READY_MODE,
+        g_param_spec_enum("ready-mode", "Ready mode",
+            "What the first frame waits for, so no blank startup frames are output",
+            GST_TYPE_CHROMIUM_SRC_READY_MODE, GST_CHROMIUM_SRC_READY_LOAD,
+            static_cast<GParamFlags>(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+    g_object_class_install_property(gobject_class, PROP_READY_TIMEOUT,
+        g_param_spec_uint("ready-timeout", "Ready timeout",
+            "Milliseconds to wait for ready-mode before outputting anyway (0 = forever)",
+            0, G_MAXUINT, 10000,
+            static_cast<GParamFlags>(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+    g_object_class_install_property(gobject_class, PROP_FRAME_SYNC,
+        g_param_spec_boolean("frame-sync", "Frame sync",
+            "Advance the page one frame per buffer and output it only after the page "
+            "called window.chromiumsrc.frameDone(); buffers are late rather than repeated",
+            FALSE,
+            static_cast<GParamFlags>(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+    g_object_class_install_property(gobject_class, PROP_IS_LIVE,
+        g_param_spec_boolean("is-live", "Is live",
+            "Run on the pipeline clock; when false the page runs on virtual time advanced "
+            "one frame per buffer, rendering as fast as possible and identically every run",
+            TRUE,
+            static_cast<GParamFlags>(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+    g_object_class_install_property(gobject_class, PROP_ALPHA_MODE,
+        g_param_spec_enum("alpha-mode", "Alpha mode",
+            "Alpha channel of RGB output: premultiplied BGRA, straight BGRA or opaque BGRx. "
+            "Caps cannot signal premultiplied alpha, so use straight for blending downstream",
+            GST_TYPE_CHROMIUM_SRC_ALPHA_MODE, GST_CHROMIUM_SRC_ALPHA_PREMULTIPLIED,
+            static_cast<GParamFlags>(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+    g_object_class_install_property(gobject_class, PROP_OUTPUT_MEMORY,
+        g_param_spec_enum("output-memory", "Output memory",
+            "Memory output frames are allocated in; memfd lets out-of-process "
+            "consumers receive file descriptors instead of pixels (Linux only)",
+            GST_TYPE_CHROMIUM_SRC_OUTPUT_MEMORY, GST_CHROMIUM_SRC_MEMORY_SYSTEM,
+            static_cast<GParamFlags>(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+    g_object_class_install_property(gobject_class, PROP_PAINT_COUNT,
+        g_param_spec_uint64("paint-count", "Paint count",
+            "Number of paints copied into output buffers",
+            0, G_MAXUINT64, 0,
+            static_cast<GParamFlags>(G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
+
+    g_object_class_install_property(gobject_class, PROP_BYTES_COPIED,
+        g_param_spec_uint64("bytes-copied", "Bytes copied",
+            "Total number of pixel bytes written into output buffers",
+            0, G_MAXUINT64, 0,
+            static_cast<GParamFlags>(G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
+
+    g_object_class_install_property(gobject_class, PROP_FRAMES_DUPLICATED,
+        g_param_spec_uint64("frames-duplicated", "Frames duplicated",
+            "Output slots filled by repeating the previous frame",
+            0, G_MAXUINT64, 0,
+            static_cast<GParamFlags>(G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
+
+    g_object_class_install_property(gobject_class, PROP_FRAMES_DROPPED,
+        g_param_spec_uint64("frames-dropped", "Frames dropped",
+            "Paints replaced before an output slot took them, plus skipped slots",
+            0, G_MAXUINT64, 0,
+            static_cast<GParamFlags>(G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
+
+    g_object_class_install_property(gobject_class, PROP_STATS,
+        g_param_spec_boxed("stats", "Statistics",
+            "Frame path counters: paints-received, frames-pushed, frames-repeated, "
+            "frames-dropped, need-data-timeouts, size-mismatches, bytes-copied and "
+            "paint-interval-min/avg/max",
+            GST_TYPE_STRUCTURE,
+            static_cast<GParamFlags>(G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
+
     gst_element_class_set_metadata(gstelement_class,
         "Chromium Source",
         "Source/Video",
@@ -112,7 +329,28 @@ static void gst_chromium_src_class_init(GstChromiumSrcClass *klass) {
 
     gst_element_class_add_static_pad_template(gstelement_class, &src_template);
 
+    static const gchar *repeat_meta_tags[] = { NULL };
+    gst_meta_register_custom(GST_CHROMIUM_SRC_REPEAT_META_NAME, repeat_meta_tags,
+        NULL, NULL, NULL);
+    begin_frame_caps = gst_caps_new_empty_simple(GST_CHROMIUM_SRC_BEGIN_FRAME_CAPS);
+    paint_caps = gst_caps_new_empty_simple(GST_CHROMIUM_SRC_PAINT_CAPS);
+    GST_MINI_OBJECT_FLAG_SET(begin_frame_caps, GST_MINI_OBJECT_FLAG_MAY_BE_LEAKED);
+    GST_MINI_OBJECT_FLAG_SET(paint_caps, GST_MINI_OBJECT_FLAG_MAY_BE_LEAKED);
+
     gstelement_class->change_state = gst_chromium_src_change_state;
+
+    gstbasesrc_class->start = gst_chromium_src_start;
+    gstbasesrc_class->stop = gst_chromium_src_stop;
+    gstbasesrc_class->negotiate = gst_chromium_src_negotiate;
+    gstbasesrc_class->set_caps = gst_chromium_src_set_caps;
+    gstbasesrc_class->decide_allocation = gst_chromium_src_decide_allocation;
+    gstbasesrc_class->query = gst_chromium_src_query;
+    gstbasesrc_class->unlock = gst_chromium_src_unlock;
+    gstbasesrc_class->unlock_stop = gst_chromium_src_unlock_stop;
+    gstbasesrc_class->is_seekable = gst_chromium_src_is_seekable;
+    gstbasesrc_class->do_seek = gst_chromium_src_do_seek;
+
+    gstpushsrc_class->create = gst_chromium_src_create;
 }
 
 /**
@@ -120,9 +358,8 @@ static void gst_chromium_src_class_init(GstChromiumSrcClass *klass) {
  * @src: The instance to initialize
  *
  * Initializes a new GstChromiumSrc instance. Sets default property values,
- * creates the internal appsrc element, sets up ghost pad, configures
- * appsrc properties, connects signals, and initializes synchronization
- * primitives and CEF-related fields.
+ * configures the base class as a live source in time format, and
+ * initializes synchronization primitives and CEF-related fields.
  *
  * Invoked automatically by GStreamer when a new chromiumsrc element
  * is created (e.g., via gst_element_factory_make).
@@ -131,47 +368,88 @@ static void gst_chromium_src_init(GstChromiumSrc *src) {
     src->url = g_strdup("https://example.com/test.html");
     src->width = 1920;
     src->height = 1080;
-    src->fps_num = 30;
-
-    src->appsrc = GST_APP_SRC(gst_element_factory_make("appsrc", "internal_appsrc"));
-    if (!src->appsrc) {
-        GST_ERROR_OBJECT(src, "Failed to create internal appsrc");
-        return;
-    }
-
-    gst_bin_add(GST_BIN(src), GST_ELEMENT(src->appsrc));
-
-    src->ghostpad = gst_ghost_pad_new("src",
-        gst_element_get_static_pad(GST_ELEMENT(src->appsrc),
-		"src"));
-    gst_element_add_pad(GST_ELEMENT(src), src->ghostpad);
-
-    g_object_set(src->appsrc, "stream-type", GST_APP_STREAM_TYPE_STREAM, NULL);
-    g_object_set(src->appsrc, "format", GST_FORMAT_TIME, NULL);
-    g_object_set(src->appsrc, "is-live", TRUE, NULL);
-    g_object_set(src->appsrc, "emit-signals", TRUE, NULL);
-    g_object_set(src->appsrc, "max-bytes", (guint64)(1920 * 1080 * 4 * 3), NULL);
-
-    g_signal_connect(src->appsrc, "need-data", G_CALLBACK(gst_chromium_src_need_data), src);
-    g_signal_connect(src->appsrc, "enough-data", G_CALLBACK(gst_chromium_src_enough_data), src);
-
-    src->frame_buffer = NULL;
+    src->fps_n = 30;
+    src->fps_d = 1;
+
+    gst_base_src_set_live(GST_BASE_SRC(src), TRUE);
+    gst_base_src_set_format(GST_BASE_SRC(src), GST_FORMAT_TIME);
+
+    gst_video_info_init(&src->info);
+    src->frame_format = FRAME_FORMAT_BGRA;
+    src->pool = NULL;
+    src->pending_buffer = NULL;
+    src->last_buffer = NULL;
+    src->clock_id = NULL;
     src->frame_size = 0;
-    src->frame_ready = FALSE;
     src->running = FALSE;
+    src->flushing = FALSE;
     src->frame_count = 0;
     src->gpu_enabled = FALSE;
     src->gpu_user_specified = FALSE;
     src->gpu_device = -1;
+    src->dirty_rects = FALSE;
+    src->invalidate = TRUE;
+    src->keep_browser = TRUE;
+    src->alpha_mode = GST_CHROMIUM_SRC_ALPHA_PREMULTIPLIED;
+    src->output_memory = GST_CHROMIUM_SRC_MEMORY_SYSTEM;
+    src->paint_count = 0;
+    src->bytes_copied = 0;
+    src->begin_frame_time = GST_CLOCK_TIME_NONE;
+    src->pending_begin_time = GST_CLOCK_TIME_NONE;
+    src->pending_paint_time = GST_CLOCK_TIME_NONE;
+    src->slot_origin = GST_CLOCK_TIME_NONE;
+    src->slot_index = 0;
+    src->repeat_count = 0;
+    src->frames_duplicated = 0;
+    src->frames_dropped = 0;
+    gst_chromium_src_reset_stats(src);
 
     g_mutex_init(&src->frame_mutex);
     g_cond_init(&src->frame_cond);
 
     src->cef_browser = NULL;
     src->cef_client = NULL;
+    src->browser_generation = 0;
+    src->browser_config = NULL;
+    src->view_width = 0;
+    src->view_height = 0;
+    src->page_loaded = FALSE;
+    src->page_ready = FALSE;
+    src->ready_mode = GST_CHROMIUM_SRC_READY_LOAD;
+    src->ready_timeout = 10000;
+    src->ready_deadline = -1;
+    src->frame_sync = FALSE;
+    src->frame_done_pending = FALSE;
+    src->capture_paint = FALSE;
+    src->budget_granted = 0;
+    src->budget_expired = 0;
+    src->budget_frame = 0;
+    src->timeline = FALSE;
+    src->navigating = FALSE;
+    src->repaint = FALSE;
+    src->announce_navigation = FALSE;
+    src->navigation_url = NULL;
+    src->navigation_status = 0;
     src->cef_thread = NULL;
 }
 
+/**
+ * gst_chromium_src_browser_config:
+ * @src: The GstChromiumSrc instance
+ *
+ * Describes the settings a browser is created with, to tell whether
+ * the running one still matches. The size is left out since a running
+ * browser is resized instead. Liveness is included since a browser
+ * runs on virtual time from its creation. Must be called with
+ * frame_mutex held, which guards url and browser_config.
+ *
+ * Returns: (transfer full): The description
+ */
+static gchar *gst_chromium_src_browser_config(GstChromiumSrc *src) {
+    return g_strdup_printf("%s %d/%d %d %d", src->url, src->fps_n, src->fps_d, src->alpha_mode,
+        gst_base_src_is_live(GST_BASE_SRC(src)));
+}
+
 /**
  * gst_chromium_src_set_property:
  * @object: The GObject instance
@@ -180,7 +458,8 @@ static void gst_chromium_src_init(GstChromiumSrc *src) {
  * @pspec: The property specification
  *
  * Handles setting of GObject properties (url, width, height, framerate).
- * Framerate is parsed as integer frames per second.
+ * Framerate is a fraction, so NTSC rates such as 30000/1001 are exact.
+ * A url set while the browser runs is loaded into it right away.
  *
  * Invoked by GObject when application code calls g_object_set() on the element.
  */
@@ -192,26 +471,42 @@ static void gst_chromium_src_set_property(
     GstChromiumSrc *src = GST_CHROMIUM_SRC(object);
 
     switch (prop_id) {
-        case PROP_URL:
+        case PROP_URL: {
+            gchar *navigate = NULL;
+
+            g_mutex_lock(&src->frame_mutex);
             g_free(src->url);
             src->url = g_value_dup_string(value);
+            if (src->url && src->cef_client && src->running) {
+                navigate = g_strdup(src->url);
+                g_free(src->browser_config);
+                src->browser_config = gst_chromium_src_browser_config(src);
+            }
+            g_mutex_unlock(&src->frame_mutex);
+
+            if (navigate) {
+                // Navigate the running browser instead of recreating it
+                GST_INFO_OBJECT(src, "Navigating to %s", navigate);
+                cef_browser_load_url(src, navigate);
+                g_free(navigate);
+            }
             break;
+        }
         case PROP_WIDTH:
             src->width = g_value_get_int(value);
+            gst_pad_mark_reconfigure(GST_BASE_SRC_PAD(src));
             break;
         case PROP_HEIGHT:
             src->height = g_value_get_int(value);
+            gst_pad_mark_reconfigure(GST_BASE_SRC_PAD(src));
             break;
-        case PROP_FRAMERATE: {
-            const gchar *fps_str = g_value_get_string(value);
-            if (fps_str) {
-                gint fps = atoi(fps_str);
-                if (fps < 1) fps = 1;
-                if (fps > 60) fps = 60;
-                src->fps_num = fps;
-            }
+        case PROP_FRAMERATE:
+            src->fps_n = gst_value_get_fraction_numerator(value);
+            src->fps_d = gst_value_get_fraction_denominator(value);
+            gst_pad_mark_reconfigure(GST_BASE_SRC_PAD(src));
+            gst_element_post_message(GST_ELEMENT(src),
+                gst_message_new_latency(GST_OBJECT(src)));
             break;
-        }
         case PROP_GPU: {
             const gchar *gpu_str = g_value_get_string(value);
             if (gpu_str) {
@@ -230,12 +525,94 @@ static void gst_chromium_src_set_property(
             }
             break;
         }
+        case PROP_DIRTY_RECTS:
+            src->dirty_rects = g_value_get_boolean(value);
+            break;
+        case PROP_INVALIDATE:
+            g_mutex_lock(&src->frame_mutex);
+            src->invalidate = g_value_get_boolean(value);
+            g_mutex_unlock(&src->frame_mutex);
+            break;
+        case PROP_KEEP_BROWSER:
+            src->keep_browser = g_value_get_boolean(value);
+            break;
+        case PROP_READY_MODE:
+            src->ready_mode = (GstChromiumSrcReadyMode)g_value_get_enum(value);
+            break;
+        case PROP_READY_TIMEOUT:
+            src->ready_timeout = g_value_get_uint(value);
+            break;
+        case PROP_FRAME_SYNC:
+            g_mutex_lock(&src->frame_mutex);
+            src->frame_sync = g_value_get_boolean(value);
+            g_mutex_unlock(&src->frame_mutex);
+            break;
+        case PROP_IS_LIVE:
+            gst_base_src_set_live(GST_BASE_SRC(src), g_value_get_boolean(value));
+            break;
+        case PROP_ALPHA_MODE:
+            src->alpha_mode = (GstChromiumSrcAlphaMode)g_value_get_enum(value);
+            gst_pad_mark_reconfigure(GST_BASE_SRC_PAD(src));
+            break;
+        case PROP_OUTPUT_MEMORY:
+            src->output_memory = (GstChromiumSrcOutputMemory)g_value_get_enum(value);
+            gst_pad_mark_reconfigure(GST_BASE_SRC_PAD(src));
+            break;
         default:
             G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
             break;
     }
 }
 
+/**
+ * gst_chromium_src_reset_stats:
+ * @src: The GstChromiumSrc instance
+ *
+ * Clears the counters only reported through the stats property.
+ */
+static void gst_chromium_src_reset_stats(GstChromiumSrc *src) {
+    src->paints_received = 0;
+    src->size_mismatches = 0;
+    src->frame_timeouts = 0;
+    src->last_paint_time = GST_CLOCK_TIME_NONE;
+    src->paint_interval_min = GST_CLOCK_TIME_NONE;
+    src->paint_interval_max = 0;
+    src->paint_interval_sum = 0;
+    src->paint_intervals = 0;
+}
+
+/**
+ * gst_chromium_src_create_stats:
+ * @src: The GstChromiumSrc instance
+ *
+ * Snapshots the frame path counters, like rtpjitterbuffer's stats.
+ * Paint intervals are GstClockTime; min and avg are
+ * GST_CLOCK_TIME_NONE until two paints were received.
+ *
+ * Returns: (transfer full): A new application/x-chromiumsrc-stats structure
+ */
+static GstStructure *gst_chromium_src_create_stats(GstChromiumSrc *src) {
+    GstStructure *stats;
+
+    g_mutex_lock(&src->frame_mutex);
+    stats = gst_structure_new("application/x-chromiumsrc-stats",
+        "paints-received", G_TYPE_UINT64, src->paints_received,
+        "frames-pushed", G_TYPE_UINT64, src->frame_count,
+        "frames-repeated", G_TYPE_UINT64, src->frames_duplicated,
+        "frames-dropped", G_TYPE_UINT64, src->frames_dropped,
+        "need-data-timeouts", G_TYPE_UINT64, src->frame_timeouts,
+        "size-mismatches", G_TYPE_UINT64, src->size_mismatches,
+        "bytes-copied", G_TYPE_UINT64, src->bytes_copied,
+        "paint-interval-min", G_TYPE_UINT64, src->paint_interval_min,
+        "paint-interval-avg", G_TYPE_UINT64, src->paint_intervals
+            ? src->paint_interval_sum / src->paint_intervals : GST_CLOCK_TIME_NONE,
+        "paint-interval-max", G_TYPE_UINT64, src->paint_interval_max,
+        NULL);
+    g_mutex_unlock(&src->frame_mutex);
+
+    return stats;
+}
+
 /**
  * gst_chromium_src_get_property:
  * @object: The GObject instance
@@ -243,7 +620,7 @@ static void gst_chromium_src_set_property(
  * @value: The value to fill
  * @pspec: The property specification
  *
- * Handles retrieval of GObject properties. Returns framerate as integer fps.
+ * Handles retrieval of GObject properties. Returns framerate as a fraction.
  *
  * Invoked by GObject when application code calls g_object_get() on the element.
  */
@@ -255,7 +632,9 @@ static void gst_chromium_src_get_property(GObject *object,
 
     switch (prop_id) {
         case PROP_URL:
+            g_mutex_lock(&src->frame_mutex);
             g_value_set_string(value, src->url);
+            g_mutex_unlock(&src->frame_mutex);
             break;
         case PROP_WIDTH:
             g_value_set_int(value, src->width);
@@ -263,14 +642,62 @@ static void gst_chromium_src_get_property(GObject *object,
         case PROP_HEIGHT:
             g_value_set_int(value, src->height);
             break;
-        case PROP_FRAMERATE: {
-            gchar *fps_str = g_strdup_printf("%d", src->fps_num);
-            g_value_take_string(value, fps_str);
+        case PROP_FRAMERATE:
+            gst_value_set_fraction(value, src->fps_n, src->fps_d);
             break;
-        }
         case PROP_GPU:
             g_value_set_string(value, src->gpu_enabled ? "true" : "auto");
             break;
+        case PROP_DIRTY_RECTS:
+            g_value_set_boolean(value, src->dirty_rects);
+            break;
+        case PROP_INVALIDATE:
+            g_value_set_boolean(value, src->invalidate);
+            break;
+        case PROP_KEEP_BROWSER:
+            g_value_set_boolean(value, src->keep_browser);
+            break;
+        case PROP_READY_MODE:
+            g_value_set_enum(value, src->ready_mode);
+            break;
+        case PROP_READY_TIMEOUT:
+            g_value_set_uint(value, src->ready_timeout);
+            break;
+        case PROP_FRAME_SYNC:
+            g_value_set_boolean(value, src->frame_sync);
+            break;
+        case PROP_IS_LIVE:
+            g_value_set_boolean(value, gst_base_src_is_live(GST_BASE_SRC(src)));
+            break;
+        case PROP_ALPHA_MODE:
+            g_value_set_enum(value, src->alpha_mode);
+            break;
+        case PROP_OUTPUT_MEMORY:
+            g_value_set_enum(value, src->output_memory);
+            break;
+        case PROP_PAINT_COUNT:
+            g_mutex_lock(&src->frame_mutex);
+            g_value_set_uint64(value, src->paint_count);
+            g_mutex_unlock(&src->frame_mutex);
+            break;
+        case PROP_BYTES_COPIED:
+            g_mutex_lock(&src->frame_mutex);
+            g_value_set_uint64(value, src->bytes_copied);
+            g_mutex_unlock(&src->frame_mutex);
+            break;
+        case PROP_FRAMES_DUPLICATED:
+            g_mutex_lock(&src->frame_mutex);
+            g_value_set_uint64(value, src->frames_duplicated);
+            g_mutex_unlock(&src->frame_mutex);
+            break;
+        case PROP_FRAMES_DROPPED:
+            g_mutex_lock(&src->frame_mutex);
+            g_value_set_uint64(value, src->frames_dropped);
+            g_mutex_unlock(&src->frame_mutex);
+            break;
+        case PROP_STATS:
+            g_value_take_boxed(value, gst_chromium_src_create_stats(src));
+            break;
         default:
             G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
             break;
@@ -282,7 +709,8 @@ static void gst_chromium_src_get_property(GObject *object,
  * @object: The GObject instance being finalized
  *
  * Releases all resources held by the GstChromiumSrc instance including
- * allocated strings, frame buffer, and synchronization primitives.
+ * allocated strings and synchronization primitives. The buffer pool and
+ * any pending frame are already released by gst_chromium_src_stop().
  *
  * Invoked by GObject when the last reference to the element is dropped
  * and the object is being destroyed.
@@ -291,7 +719,8 @@ static void gst_chromium_src_finalize(GObject *object) {
     GstChromiumSrc *src = GST_CHROMIUM_SRC(object);
 
     g_free(src->url);
-    g_free(src->frame_buffer);
+    g_free(src->browser_config);
+    g_free(src->navigation_url);
     g_mutex_clear(&src->frame_mutex);
     g_cond_clear(&src->frame_cond);
 
@@ -299,264 +728,1087 @@ static void gst_chromium_src_finalize(GObject *object) {
 }
 
 /**
- * gst_chromium_src_need_data:
- * @appsrc: The internal appsrc element requesting data
- * @length: Hint for the amount of data needed (not used)
- * @user_data: The GstChromiumSrc instance
+ * gst_chromium_src_negotiate:
+ * @basesrc: The GstBaseSrc instance
+ *
+ * Negotiates caps with downstream. The framerate is the property's;
+ * width and height are whatever downstream requires, fixated to the
+ * properties where it leaves a choice, so the page is laid out at the
+ * output size instead of being scaled. RGB is preferred as it is what
+ * Chromium paints, BGRx instead of BGRA when alpha-mode is opaque;
+ * I420 and NV12 are picked when downstream asks for them, in which
+ * case OnPaint() converts while copying and no videoconvert is needed.
  *
- * Callback invoked when the downstream pipeline needs more data.
- * Waits for a frame from CEF (signaled via frame_cond), copies it to
- * a GstBuffer with proper timestamps, and pushes it downstream.
- * Implements the producer side of the frame synchronization.
+ * Invoked by GstBaseSrc before streaming starts and whenever the src
+ * pad is marked for reconfiguration.
  *
- * Invoked by appsrc when its internal buffer runs low and it needs
- * more data to feed the downstream pipeline.
+ * Returns: TRUE if downstream accepted the caps, FALSE otherwise
  */
-static void gst_chromium_src_need_data(GstAppSrc *appsrc, guint length,
-    gpointer user_data) {
-    GstChromiumSrc *src = GST_CHROMIUM_SRC(user_data);
-    GstBuffer *buffer;
-    GstMapInfo map;
-    GstFlowReturn ret;
-    GstClockTime duration, timestamp;
+static gboolean gst_chromium_src_negotiate(GstBaseSrc *basesrc) {
+    GstChromiumSrc *src = GST_CHROMIUM_SRC(basesrc);
+    GstCaps *caps, *peercaps;
+    gboolean ret;
+
+    // RGB output carries alpha unless alpha-mode is opaque
+    GValue formats = G_VALUE_INIT, format = G_VALUE_INIT;
+    g_value_init(&formats, GST_TYPE_LIST);
+    g_value_init(&format, G_TYPE_STRING);
+    const gchar *names[] = {
+        src->alpha_mode == GST_CHROMIUM_SRC_ALPHA_OPAQUE ? "BGRx" : "BGRA", "I420", "NV12"
+    };
+    for (const gchar *name : names) {
+        g_value_set_static_string(&format, name);
+        gst_value_list_append_value(&formats, &format);
+    }
+    g_value_unset(&format);
+
+    caps = gst_pad_get_pad_template_caps(GST_BASE_SRC_PAD(basesrc));
+    caps = gst_caps_make_writable(caps);
+    gst_caps_set_value(caps, "format", &formats);
+    g_value_unset(&formats);
+    gst_caps_set_simple(caps,
+        "framerate", GST_TYPE_FRACTION, src->fps_n, src->fps_d,
+        NULL);
+
+    peercaps = gst_pad_peer_query_caps(GST_BASE_SRC_PAD(basesrc), caps);
+    if (peercaps && gst_caps_is_empty(peercaps)) {
+        GST_ERROR_OBJECT(src, "Downstream does not accept %" GST_PTR_FORMAT, caps);
+        GST_ELEMENT_ERROR(src, STREAM, FORMAT,
+            ("Downstream does not accept the configured format"), (NULL));
+        gst_caps_unref(peercaps);
+        gst_caps_unref(caps);
+        return FALSE;
+    }
+    if (peercaps && !gst_caps_is_any(peercaps)) {
+        // Keep our format order so BGRA wins whenever downstream allows it
+        GstCaps *common = gst_caps_intersect_full(caps, peercaps, GST_CAPS_INTERSECT_FIRST);
+        gst_caps_unref(caps);
+        caps = common;
+    }
+    if (peercaps) {
+        gst_caps_unref(peercaps);
+    }
+
+    caps = gst_caps_truncate(caps);
+    caps = gst_caps_make_writable(caps);
+    GstStructure *s = gst_caps_get_structure(caps, 0);
+    gst_structure_fixate_field_nearest_int(s, "width", src->width);
+    gst_structure_fixate_field_nearest_int(s, "height", src->height);
+    caps = gst_caps_fixate(caps);
+    GST_INFO_OBJECT(src, "Setting caps: %" GST_PTR_FORMAT, caps);
+    ret = gst_base_src_set_caps(basesrc, caps);
+    gst_caps_unref(caps);
+
+    return ret;
+}
+
+/**
+ * gst_chromium_src_set_caps:
+ * @basesrc: The GstBaseSrc instance
+ * @caps: The negotiated caps
+ *
+ * Stores the video info of the negotiated caps, used to map the
+ * pooled buffers OnPaint() renders into, and prepares the YUV
+ * coefficients matching the negotiated colorimetry. Resizes the
+ * browser when the negotiated size differs from its view, and restarts
+ * the slot grid at the next slot when the framerate changed.
+ *
+ * Invoked by gst_base_src_set_caps() during negotiation.
+ *
+ * Returns: TRUE if the caps are valid raw video caps
+ */
+static gboolean gst_chromium_src_set_caps(GstBaseSrc *basesrc, GstCaps *caps) {
+    GstChromiumSrc *src = GST_CHROMIUM_SRC(basesrc);
+    GstVideoInfo info;
+    FrameFormat format;
+    FrameYuvMatrix matrix = {};
+    gdouble kr, kb;
+
+    if (!gst_video_info_from_caps(&info, caps)) {
+        GST_ERROR_OBJECT(src, "Invalid caps %" GST_PTR_FORMAT, caps);
+        return FALSE;
+    }
+
+    switch (GST_VIDEO_INFO_FORMAT(&info)) {
+        case GST_VIDEO_FORMAT_BGRA:
+            if (src->alpha_mode == GST_CHROMIUM_SRC_ALPHA_STRAIGHT) {
+                format = FRAME_FORMAT_BGRA_STRAIGHT;
+            } else {
+                // Caps cannot say the alpha is premultiplied, so
+                // downstream blends this as straight alpha
+                format = FRAME_FORMAT_BGRA;
+            }
+            break;
+        case GST_VIDEO_FORMAT_BGRx:
+            // Same bytes, downstream ignores the alpha byte
+            format = FRAME_FORMAT_BGRA;
+            break;
+        case GST_VIDEO_FORMAT_I420:
+            format = FRAME_FORMAT_I420;
+            break;
+        case GST_VIDEO_FORMAT_NV12:
+            format = FRAME_FORMAT_NV12;
+            break;
+        default:
+            GST_ERROR_OBJECT(src, "Unsupported format %s",
+                gst_video_format_to_string(GST_VIDEO_INFO_FORMAT(&info)));
+            return FALSE;
+    }
+
+    if (format == FRAME_FORMAT_I420 || format == FRAME_FORMAT_NV12) {
+        if (!gst_video_color_matrix_get_Kr_Kb(info.colorimetry.matrix, &kr, &kb)) {
+            // RGB or unknown matrix, use BT.709 like the default caps
+            gst_video_color_matrix_get_Kr_Kb(GST_VIDEO_COLOR_MATRIX_BT709, &kr, &kb);
+        }
+        frame_yuv_matrix_init(&matrix, kr, kb,
+            info.colorimetry.range == GST_VIDEO_COLOR_RANGE_0_255);
+        GST_INFO_OBJECT(src, "Converting to %s with %s kernels",
+            GST_VIDEO_INFO_NAME(&info), frame_convert_backend());
+    } else if (format == FRAME_FORMAT_BGRA_STRAIGHT) {
+        GST_INFO_OBJECT(src, "Un-premultiplying alpha with %s kernels",
+            frame_convert_backend());
+    }
+
+    g_mutex_lock(&src->frame_mutex);
+    if (GST_CLOCK_TIME_IS_VALID(src->slot_origin) && src->info.fps_n > 0 &&
+        (info.fps_n != src->info.fps_n || info.fps_d != src->info.fps_d)) {
+        // Restart the slot grid at the next slot of the old rate
+        src->slot_origin += gst_util_uint64_scale(src->slot_index,
+            (guint64)src->info.fps_d * GST_SECOND, src->info.fps_n);
+        src->slot_index = 0;
+        GST_INFO_OBJECT(src, "Framerate changed to %d/%d", info.fps_n, info.fps_d);
+    }
+    src->info = info;
+    src->frame_format = format;
+    src->yuv_matrix = matrix;
+    src->frame_size = GST_VIDEO_INFO_SIZE(&info);
+    gboolean resize = GST_VIDEO_INFO_WIDTH(&info) != src->view_width ||
+                      GST_VIDEO_INFO_HEIGHT(&info) != src->view_height;
+    g_mutex_unlock(&src->frame_mutex);
+
+    if (resize) {
+        GST_INFO_OBJECT(src, "Resizing page to %dx%d",
+            GST_VIDEO_INFO_WIDTH(&info), GST_VIDEO_INFO_HEIGHT(&info));
+        cef_browser_resize(src, GST_VIDEO_INFO_WIDTH(&info), GST_VIDEO_INFO_HEIGHT(&info));
+    }
+
+    return TRUE;
+}
+
+/**
+ * gst_chromium_src_decide_allocation:
+ * @basesrc: The GstBaseSrc instance
+ * @query: The answered ALLOCATION query
+ *
+ * Picks the buffer pool OnPaint() renders into. Uses the pool offered
+ * downstream when it accepts our configuration, so frames can land
+ * directly in downstream memory, and falls back to a GstVideoBufferPool
+ * of our own otherwise. With output-memory=memfd our own pool is always
+ * used, allocating every buffer in a sealed memfd.
+ *
+ * Invoked by GstBaseSrc after negotiation, once downstream answered
+ * the ALLOCATION query.
+ *
+ * Returns: TRUE on success, FALSE on failure
+ */
+static gboolean gst_chromium_src_decide_allocation(GstBaseSrc *basesrc, GstQuery *query) {
+    GstChromiumSrc *src = GST_CHROMIUM_SRC(basesrc);
+    GstBufferPool *pool = NULL;
+    GstStructure *config;
+    GstCaps *caps;
+    GstVideoInfo info;
+    guint size = 0, min = 0, max = 0;
+    GstAllocator *allocator = NULL;
+    GstAllocationParams params;
+    gboolean update, video_meta, memfd;
+
+    gst_query_parse_allocation(query, &caps, NULL);
+    if (!caps || !gst_video_info_from_caps(&info, caps)) {
+        GST_ERROR_OBJECT(src, "No valid caps in allocation query");
+        return FALSE;
+    }
+
+    memfd = src->output_memory == GST_CHROMIUM_SRC_MEMORY_MEMFD;
+    if (memfd && !gst_memfd_allocator_is_supported()) {
+        GST_WARNING_OBJECT(src, "memfd not supported here, using system memory");
+        memfd = FALSE;
+    }
+
+    video_meta = gst_query_find_allocation_meta(query, GST_VIDEO_META_API_TYPE, NULL);
+
+    // Step 1: Take the downstream pool, if any
+    update = gst_query_get_n_allocation_pools(query) > 0;
+    if (update) {
+        gst_query_parse_nth_allocation_pool(query, 0, &pool, &size, &min, &max);
+    }
+
+    size = MAX(size, (guint)info.size);
+    min = MAX(min, CHROMIUM_SRC_MIN_BUFFERS);
+    if (max != 0 && max < min) {
+        max = min;
+    }
+
+    if (pool && memfd) {
+        GST_INFO_OBJECT(src, "Ignoring downstream pool for memfd output");
+        gst_object_unref(pool);
+        pool = NULL;
+    }
+
+    if (pool) {
+        config = gst_buffer_pool_get_config(pool);
+        gst_buffer_pool_config_set_params(config, caps, size, min, max);
+        if (video_meta) {
+            gst_buffer_pool_config_add_option(config, GST_BUFFER_POOL_OPTION_VIDEO_META);
+        }
+        if (gst_buffer_pool_set_config(pool, config)) {
+            GST_INFO_OBJECT(src, "Using downstream pool %" GST_PTR_FORMAT, pool);
+        } else {
+            GST_INFO_OBJECT(src, "Downstream pool rejected config, using own pool");
+            gst_object_unref(pool);
+            pool = NULL;
+        }
+    }
+
+    // Step 2: Fall back to our own pool
+    if (!pool) {
+        size = (guint)info.size;
+        max = 0;
+        pool = gst_video_buffer_pool_new();
+        config = gst_buffer_pool_get_config(pool);
+        gst_buffer_pool_config_set_params(config, caps, size, min, max);
+        gst_buffer_pool_config_add_option(config, GST_BUFFER_POOL_OPTION_VIDEO_META);
+        if (memfd) {
+            allocator = gst_memfd_allocator_new();
+            gst_allocation_params_init(&params);
+            gst_buffer_pool_config_set_allocator(config, allocator, &params);
+        }
+        if (!gst_buffer_pool_set_config(pool, config)) {
+            GST_ERROR_OBJECT(src, "Failed to configure buffer pool");
+            gst_object_unref(pool);
+            if (allocator) {
+                gst_object_unref(allocator);
+            }
+            return FALSE;
+        }
+    }
+
+    if (allocator) {
+        GST_INFO_OBJECT(src, "Allocating output frames in memfd");
+        if (gst_query_get_n_allocation_params(query) > 0) {
+            gst_query_set_nth_allocation_param(query, 0, allocator, &params);
+        } else {
+            gst_query_add_allocation_param(query, allocator, &params);
+        }
+        gst_object_unref(allocator);
+    }
+
+    if (update) {
+        gst_query_set_nth_allocation_pool(query, 0, pool, size, min, max);
+    } else {
+        gst_query_add_allocation_pool(query, pool, size, min, max);
+    }
+    gst_object_unref(pool);
+
+    return TRUE;
+}
+
+/**
+ * gst_chromium_src_query:
+ * @basesrc: The GstBaseSrc instance
+ * @query: The query to answer
+ *
+ * Answers LATENCY queries: frames are produced live and reach
+ * downstream at most one frame duration after they were timestamped.
+ * Everything else, and latency when not live, is handled by GstBaseSrc.
+ *
+ * Invoked by GStreamer when a query reaches the src pad.
+ *
+ * Returns: TRUE if the query was answered
+ */
+static gboolean gst_chromium_src_query(GstBaseSrc *basesrc, GstQuery *query) {
+    GstChromiumSrc *src = GST_CHROMIUM_SRC(basesrc);
+
+    if (GST_QUERY_TYPE(query) == GST_QUERY_LATENCY && gst_base_src_is_live(basesrc)) {
+        GstClockTime latency;
+
+        if (src->fps_n <= 0 || src->fps_d <= 0) {
+            return FALSE;
+        }
+
+        latency = gst_util_uint64_scale_ceil(GST_SECOND, src->fps_d, src->fps_n);
+        GST_DEBUG_OBJECT(src, "Reporting latency of %" GST_TIME_FORMAT,
+            GST_TIME_ARGS(latency));
+        gst_query_set_latency(query, TRUE, latency, latency);
+        return TRUE;
+    }
+
+    return GST_BASE_SRC_CLASS(parent_class)->query(basesrc, query);
+}
+
+/**
+ * gst_chromium_src_unlock:
+ * @basesrc: The GstBaseSrc instance
+ *
+ * Wakes up create() if it is waiting for a frame or an output slot
+ * so flushing seeks and state changes return immediately.
+ *
+ * Invoked by GstBaseSrc when streaming must be interrupted.
+ *
+ * Returns: TRUE always
+ */
+static gboolean gst_chromium_src_unlock(GstBaseSrc *basesrc) {
+    GstChromiumSrc *src = GST_CHROMIUM_SRC(basesrc);
+
+    GST_DEBUG_OBJECT(src, "unlock");
+
+    g_mutex_lock(&src->frame_mutex);
+    src->flushing = TRUE;
+    if (src->clock_id) {
+        gst_clock_id_unschedule(src->clock_id);
+    }
+    g_cond_broadcast(&src->frame_cond);
+    g_mutex_unlock(&src->frame_mutex);
+
+    return TRUE;
+}
+
+/**
+ * gst_chromium_src_unlock_stop:
+ * @basesrc: The GstBaseSrc instance
+ *
+ * Clears the flushing state set by gst_chromium_src_unlock().
+ *
+ * Invoked by GstBaseSrc when streaming may resume.
+ *
+ * Returns: TRUE always
+ */
+static gboolean gst_chromium_src_unlock_stop(GstBaseSrc *basesrc) {
+    GstChromiumSrc *src = GST_CHROMIUM_SRC(basesrc);
+
+    GST_DEBUG_OBJECT(src, "unlock_stop");
+
+    g_mutex_lock(&src->frame_mutex);
+    src->flushing = FALSE;
+    g_mutex_unlock(&src->frame_mutex);
+
+    return TRUE;
+}
+
+/**
+ * gst_chromium_src_is_seekable:
+ * @basesrc: The GstBaseSrc instance
+ *
+ * Only a non-live element is seekable: its page runs on virtual time,
+ * so its animation timeline can be set to any position.
+ *
+ * Invoked by GstBaseSrc when answering SEEKING queries and seeks.
+ *
+ * Returns: TRUE when not live
+ */
+static gboolean gst_chromium_src_is_seekable(GstBaseSrc *basesrc) {
+    return !gst_base_src_is_live(basesrc);
+}
 
-    GST_DEBUG_OBJECT(src, "need-data: length=%u", length);
+/**
+ * gst_chromium_src_do_seek:
+ * @basesrc: The GstBaseSrc instance
+ * @segment: The segment to start output at
+ *
+ * Moves output to the first frame at or after the segment start and
+ * drops frames rendered for the old position. The first seek that
+ * changes the position hands the page's animation timeline over to
+ * the element: from then on CSS and Web Animations are paused and set,
+ * and requestAnimationFrame callbacks are called, at each buffer's
+ * timestamp (see cef_browser_advance_time()). The initial seek
+ * GstBaseSrc does on every start leaves the page alone. A virtual time
+ * budget still running is left to expire without capturing anything;
+ * the next buffer's budget is only granted after it.
+ *
+ * Invoked by GstBaseSrc with streaming stopped, for the initial
+ * segment and for every TIME seek.
+ *
+ * Returns: TRUE if the seek was done, FALSE for reverse playback
+ */
+static gboolean gst_chromium_src_do_seek(GstBaseSrc *basesrc, GstSegment *segment) {
+    GstChromiumSrc *src = GST_CHROMIUM_SRC(basesrc);
+    guint64 index;
 
-    if (!src->running) {
-        return;
+    if (segment->rate < 0.0) {
+        GST_WARNING_OBJECT(src, "Reverse playback is not supported");
+        return FALSE;
     }
 
+    index = gst_util_uint64_scale_ceil(segment->start, src->fps_n,
+        (guint64)src->fps_d * GST_SECOND);
+    segment->position = gst_chromium_src_slot_time(src, index);
+    segment->time = segment->start;
+
     g_mutex_lock(&src->frame_mutex);
+    if (index != src->frame_count && !src->timeline) {
+        GST_INFO_OBJECT(src, "Taking over the page timeline");
+        src->timeline = TRUE;
+    }
+    src->frame_count = index;
+    // A budget granted before the seek may still expire; it must not
+    // capture a paint for the new position
+    if (!gst_base_src_is_live(basesrc)) {
+        src->budget_frame = 0;
+        src->frame_done_pending = TRUE;
+        src->capture_paint = FALSE;
+    }
+    gst_buffer_replace(&src->pending_buffer, NULL);
+    gst_buffer_replace(&src->last_buffer, NULL);
+    g_mutex_unlock(&src->frame_mutex);
+
+    GST_DEBUG_OBJECT(src, "Seeked to frame %" G_GUINT64_FORMAT " at %" GST_TIME_FORMAT,
+        index, GST_TIME_ARGS(segment->position));
+    return TRUE;
+}
+
+/**
+ * gst_chromium_src_update_pool:
+ * @src: The GstChromiumSrc instance
+ *
+ * Publishes the pool GstBaseSrc activated after the last allocation
+ * decision to OnPaint(). Pending and last frames from a previous pool
+ * are dropped since they may no longer match the negotiated caps.
+ *
+ * Invoked by gst_chromium_src_create() before waiting for a frame.
+ */
+static void gst_chromium_src_update_pool(GstChromiumSrc *src) {
+    GstBufferPool *pool = gst_base_src_get_buffer_pool(GST_BASE_SRC(src));
+    GstBufferPool *old = NULL;
+
+    g_mutex_lock(&src->frame_mutex);
+    if (pool != src->pool) {
+        GST_DEBUG_OBJECT(src, "Painting into pool %" GST_PTR_FORMAT, pool);
+        old = src->pool;
+        src->pool = pool;
+        pool = NULL;
+        gst_clear_buffer(&src->pending_buffer);
+        gst_clear_buffer(&src->last_buffer);
+    }
+    g_mutex_unlock(&src->frame_mutex);
 
-    while (!src->frame_ready && src->running) {
+    if (old) {
+        gst_object_unref(old);
+    }
+    if (pool) {
+        gst_object_unref(pool);
+    }
+}
+
+/**
+ * gst_chromium_src_wait_frame:
+ * @src: The GstChromiumSrc instance
+ *
+ * Waits until OnPaint() delivered a frame, warning and requesting a
+ * new frame once per second while nothing arrives. With frame-sync a
+ * page that did not call frameDone() within that second, or when not
+ * live a virtual time budget that did not expire, is captured as it
+ * is. Must be called with frame_mutex held.
+ *
+ * Invoked by gst_chromium_src_create() while no frame is available
+ * to duplicate.
+ *
+ * Returns: TRUE if a frame is pending, FALSE when flushing
+ */
+static gboolean gst_chromium_src_wait_frame(GstChromiumSrc *src) {
+    while (!src->pending_buffer && !src->flushing) {
         gint64 end_time = g_get_monotonic_time() + G_TIME_SPAN_SECOND;
         if (!g_cond_wait_until(&src->frame_cond, &src->frame_mutex, end_time)) {
-            GST_WARNING_OBJECT(src, "Timeout waiting for frame");
-            g_mutex_unlock(&src->frame_mutex);
-            return;
+            if (src->frame_done_pending) {
+                GST_WARNING_OBJECT(src, "Frame not completed in time, capturing anyway");
+                src->frame_done_pending = FALSE;
+                src->capture_paint = TRUE;
+                src->repaint = TRUE;
+            } else {
+                GST_WARNING_OBJECT(src, "Timeout waiting for frame");
+            }
+            src->frame_timeouts++;
+            // The request may have been lost while the browser was created
+            cef_browser_request_frame(src);
         }
     }
 
-    if (!src->running || !src->frame_buffer) {
-        g_mutex_unlock(&src->frame_mutex);
-        return;
+    return !src->flushing;
+}
+
+/**
+ * gst_chromium_src_wait_ready:
+ * @src: The GstChromiumSrc instance
+ *
+ * Waits until the page is ready as configured by ready-mode, or until
+ * ready-timeout expired since the first call. Keeps requesting frames
+ * meanwhile, since with external begin frames pages waiting for
+ * requestAnimationFrame would otherwise never get ready. When not live,
+ * virtual time is advanced instead, for pages waiting on timers, but
+ * only once the main frame loaded and in steps of one frame duration
+ * that are only granted once the previous budget expired, so the
+ * page's clock depends on its own work and not on how long loading
+ * took in real time. None of these budgets captures a frame. Once
+ * ready one more frame is requested for the repaint. Must be called
+ * with frame_mutex held.
+ *
+ * Invoked by gst_chromium_src_create() before the first frame.
+ *
+ * Returns: TRUE when ready or timed out, FALSE when flushing
+ */
+static gboolean gst_chromium_src_wait_ready(GstChromiumSrc *src) {
+    gint64 interval = (gint64)gst_util_uint64_scale_ceil(G_USEC_PER_SEC, src->fps_d, src->fps_n);
+    gboolean live = gst_base_src_is_live(GST_BASE_SRC(src));
+    gboolean waited = FALSE;
+
+    if (src->ready_deadline < 0 && src->ready_timeout > 0) {
+        src->ready_deadline = g_get_monotonic_time() + (gint64)src->ready_timeout * 1000;
     }
 
-    buffer = gst_buffer_new_and_alloc(src->frame_size);
-    if (!buffer) {
-        GST_ERROR_OBJECT(src, "Failed to allocate buffer");
-        g_mutex_unlock(&src->frame_mutex);
-        return;
+    while (!src->page_ready && !src->flushing) {
+        gint64 now = g_get_monotonic_time();
+
+        if (src->ready_deadline >= 0 && now >= src->ready_deadline) {
+            GST_WARNING_OBJECT(src, "Page not ready after %u ms, starting anyway",
+                src->ready_timeout);
+            src->page_ready = TRUE;
+            src->repaint = TRUE;
+            break;
+        }
+
+        if (live) {
+            cef_browser_request_frame(src);
+        } else if (src->page_loaded && src->budget_expired == src->budget_granted) {
+            src->budget_granted++;
+            cef_browser_advance_time(src, gst_chromium_src_slot_time(src, 1), GST_CLOCK_TIME_NONE);
+        }
+        waited = TRUE;
+        gint64 end_time = now + interval;
+        if (src->ready_deadline >= 0) {
+            end_time = MIN(end_time, src->ready_deadline);
+        }
+        g_cond_wait_until(&src->frame_cond, &src->frame_mutex, end_time);
     }
 
-    gst_buffer_map(buffer, &map, GST_MAP_WRITE);
-    memcpy(map.data, src->frame_buffer, src->frame_size);
-    gst_buffer_unmap(buffer, &map);
+    if (waited && !src->flushing) {
+        cef_browser_request_frame(src);
+    }
 
-    src->frame_ready = FALSE;
-    g_mutex_unlock(&src->frame_mutex);
+    return !src->flushing;
+}
 
-    duration = gst_util_uint64_scale(GST_SECOND, 1, src->fps_num);
-    timestamp = src->frame_count * duration;
+/**
+ * gst_chromium_src_advance_time:
+ * @src: The GstChromiumSrc instance
+ *
+ * Grants the page the virtual time of the current output slot, once
+ * every budget granted before expired. Only the expiry of this budget
+ * arms the capture of the next paint, so a budget still running after
+ * a frame timed out, or granted while waiting for the page to get
+ * ready, never decides what a buffer shows. Must be called with
+ * frame_mutex held.
+ *
+ * Invoked by gst_chromium_src_create() for every buffer when not live.
+ *
+ * Returns: TRUE once the budget is granted, FALSE when flushing
+ */
+static gboolean gst_chromium_src_advance_time(GstChromiumSrc *src) {
+    GstClockTime start = gst_chromium_src_slot_time(src, src->frame_count);
 
-    GST_BUFFER_PTS(buffer) = timestamp;
-    GST_BUFFER_DTS(buffer) = timestamp;
-    GST_BUFFER_DURATION(buffer) = duration;
+    while (src->budget_expired != src->budget_granted && !src->flushing) {
+        gint64 end_time = g_get_monotonic_time() + G_TIME_SPAN_SECOND;
+        if (!g_cond_wait_until(&src->frame_cond, &src->frame_mutex, end_time)) {
+            GST_WARNING_OBJECT(src, "Timeout waiting for the previous virtual time budget");
+        }
+    }
+    if (src->flushing) {
+        return FALSE;
+    }
 
-    src->frame_count++;
+    src->budget_frame = ++src->budget_granted;
+    cef_browser_advance_time(src, gst_chromium_src_slot_time(src, src->frame_count + 1) - start,
+        src->timeline ? start : GST_CLOCK_TIME_NONE);
+    return TRUE;
+}
 
-    GST_DEBUG_OBJECT(src,
-		"Pushing buffer: ts=%" GST_TIME_FORMAT " dur=%" GST_TIME_FORMAT,
-        GST_TIME_ARGS(timestamp),
-        GST_TIME_ARGS(duration));
+/**
+ * gst_chromium_src_wait_slot:
+ * @src: The GstChromiumSrc instance
+ * @clock: The pipeline clock
+ * @time: Absolute clock time of the output slot
+ *
+ * Blocks on the pipeline clock until the output slot is due. The wait
+ * is unscheduled by gst_chromium_src_unlock().
+ *
+ * Invoked by gst_chromium_src_create() before picking a frame.
+ *
+ * Returns: TRUE when the slot is due, FALSE when flushing
+ */
+static gboolean gst_chromium_src_wait_slot(GstChromiumSrc *src, GstClock *clock, GstClockTime time) {
+    GstClockReturn ret;
+    GstClockID id;
 
-    ret = gst_app_src_push_buffer(src->appsrc, buffer);
-    if (ret != GST_FLOW_OK) {
-        GST_WARNING_OBJECT(src, "push-buffer returned %d", ret);
+    g_mutex_lock(&src->frame_mutex);
+    if (src->flushing) {
+        g_mutex_unlock(&src->frame_mutex);
+        return FALSE;
     }
+    id = src->clock_id = gst_clock_new_single_shot_id(clock, time);
+    g_mutex_unlock(&src->frame_mutex);
+
+    ret = gst_clock_id_wait(id, NULL);
+
+    g_mutex_lock(&src->frame_mutex);
+    gst_clock_id_unref(src->clock_id);
+    src->clock_id = NULL;
+    g_mutex_unlock(&src->frame_mutex);
+
+    return ret != GST_CLOCK_UNSCHEDULED;
 }
 
 /**
- * gst_chromium_src_enough_data:
- * @appsrc: The internal appsrc element
- * @user_data: The GstChromiumSrc instance
+ * gst_chromium_src_slot_time:
+ * @src: The GstChromiumSrc instance
+ * @index: Output slot number
+ *
+ * Computes the offset of an output slot from the slot origin. Every
+ * slot is derived from its index rather than by adding durations, so
+ * fractional rates such as 30000/1001 never drift.
  *
- * Callback invoked when the internal appsrc buffer is full.
- * Currently only logs a debug message; could be used to pause
- * frame production if needed.
+ * Invoked by gst_chromium_src_create() for every output slot, and by
+ * gst_chromium_src_do_seek() to find the first slot of a segment.
  *
- * Invoked by appsrc when its internal queue reaches max-bytes limit.
+ * Returns: The slot's offset from the first slot
  */
-static void gst_chromium_src_enough_data(GstAppSrc *appsrc, gpointer user_data) {
-    GstChromiumSrc *src = GST_CHROMIUM_SRC(user_data);
-    GST_DEBUG_OBJECT(src, "enough-data");
+static GstClockTime gst_chromium_src_slot_time(GstChromiumSrc *src, guint64 index) {
+    return gst_util_uint64_scale(index, (guint64)src->fps_d * GST_SECOND, src->fps_n);
 }
 
 /**
- * gst_chromium_src_start:
+ * gst_chromium_src_create:
+ * @pushsrc: The GstPushSrc instance
+ * @outbuf: Output location for the produced buffer
+ *
+ * Produces one frame per output slot on the pipeline clock. Each call
+ * first requests exactly one frame from Chromium, so rendering is paced
+ * by the output rate rather than by a timer of its own. The slot grid
+ * is anchored at the running time the first frame was captured, so
+ * timestamps follow the clock rather than the paint rate. A slot with
+ * no new paint repeats the previous frame (sharing its memory and
+ * tagged with a GstChromiumSrcRepeatMeta), paints replaced before a
+ * slot takes them count as dropped, and slots missed entirely are
+ * skipped with a DISCONT. Without a clock, every output waits for a
+ * fresh paint and is timestamped by frame count.
+ * With frame-sync every output waits for the page to call frameDone()
+ * and for the paint after that, and late buffers keep their slot, so
+ * buffer N always shows the page after N frame advances. When not live
+ * the page runs on virtual time, advanced by one frame duration per
+ * buffer, and outputs are produced as fast as Chromium paints them;
+ * after a seek its animations are set to each buffer's timestamp.
+ * The first frame is held back until the page is ready (see
+ * ready-mode), so sinks complete their asynchronous state change on
+ * real content rather than a blank page.
+ * Fresh frames get GstReferenceTimestampMetas with their begin frame
+ * and paint times, which repeats inherit from the frame they copy.
+ *
+ * Invoked by GstPushSrc on the streaming thread for every output frame.
+ *
+ * Returns: GST_FLOW_OK with a buffer, or GST_FLOW_FLUSHING when
+ *          interrupted by gst_chromium_src_unlock()
+ */
+static GstFlowReturn gst_chromium_src_create(GstPushSrc *pushsrc, GstBuffer **outbuf) {
+    GstChromiumSrc *src = GST_CHROMIUM_SRC(pushsrc);
+    GstClock *clock;
+    GstClockTime base_time, now, slot, duration;
+    GstClockTime begin_time = GST_CLOCK_TIME_NONE, paint_time = GST_CLOCK_TIME_NONE;
+    GstBuffer *buffer;
+    gboolean discont = FALSE;
+    gboolean fresh;
+    gboolean sync;
+    gboolean live = gst_base_src_is_live(GST_BASE_SRC(src));
+
+    gst_chromium_src_update_pool(src);
+
+    // Have Chromium render the frame for this slot while we wait for it.
+    // With frame-sync this only advances the page; the paint that is
+    // output is requested once the page called frameDone(). When not
+    // live virtual time is advanced by one frame once the page is
+    // ready, and the paint is requested once that budget expired
+    g_mutex_lock(&src->frame_mutex);
+    sync = src->frame_sync;
+    src->frame_done_pending = sync || !live;
+    src->capture_paint = FALSE;
+    src->budget_frame = 0;
+    g_mutex_unlock(&src->frame_mutex);
+    if (live) {
+        cef_browser_request_frame(src);
+    }
+
+    // Without a clock every output waits for a fresh paint, which is
+    // what rendering on virtual time needs
+    clock = live ? gst_element_get_clock(GST_ELEMENT(src)) : NULL;
+    base_time = gst_element_get_base_time(GST_ELEMENT(src));
+
+    // Step 1: Wait for the page, then for a frame when there is nothing
+    // to repeat, or for every frame with frame-sync
+    g_mutex_lock(&src->frame_mutex);
+    if (!src->last_buffer || !clock || sync) {
+        if (!gst_chromium_src_wait_ready(src) ||
+            (!live && !gst_chromium_src_advance_time(src)) ||
+            !gst_chromium_src_wait_frame(src)) {
+            g_mutex_unlock(&src->frame_mutex);
+            if (clock) {
+                gst_object_unref(clock);
+            }
+            GST_DEBUG_OBJECT(src, "Flushing");
+            return GST_FLOW_FLUSHING;
+        }
+        if (clock && !GST_CLOCK_TIME_IS_VALID(src->slot_origin)) {
+            now = gst_clock_get_time(clock);
+            src->slot_origin = now > base_time ? now - base_time : 0;
+            src->slot_index = 0;
+            GST_DEBUG_OBJECT(src, "First frame at running time %" GST_TIME_FORMAT,
+                GST_TIME_ARGS(src->slot_origin));
+        }
+    }
+    g_mutex_unlock(&src->frame_mutex);
+
+    // Step 2: Wait for the output slot on the pipeline clock
+    if (clock) {
+        slot = src->slot_origin + gst_chromium_src_slot_time(src, src->slot_index);
+        duration = src->slot_origin + gst_chromium_src_slot_time(src, src->slot_index + 1) - slot;
+        now = gst_clock_get_time(clock);
+        now = now > base_time ? now - base_time : 0;
+
+        if (now > slot + duration && !sync) {
+            // Jump to the slot the clock is in now
+            guint64 index = gst_util_uint64_scale(now - src->slot_origin, src->fps_n,
+                (guint64)src->fps_d * GST_SECOND);
+            guint64 behind = index - src->slot_index;
+
+            GST_DEBUG_OBJECT(src, "Late by %" G_GUINT64_FORMAT " slots, skipping", behind);
+            src->slot_index = index;
+            slot = src->slot_origin + gst_chromium_src_slot_time(src, index);
+            duration = src->slot_origin + gst_chromium_src_slot_time(src, index + 1) - slot;
+            discont = TRUE;
+
+            g_mutex_lock(&src->frame_mutex);
+            src->frames_dropped += behind;
+            g_mutex_unlock(&src->frame_mutex);
+        }
+
+        if (!gst_chromium_src_wait_slot(src, clock, base_time + slot)) {
+            gst_object_unref(clock);
+            GST_DEBUG_OBJECT(src, "Flushing");
+            return GST_FLOW_FLUSHING;
+        }
+        gst_object_unref(clock);
+        src->slot_index++;
+    } else {
+        slot = gst_chromium_src_slot_time(src, src->frame_count);
+        duration = gst_chromium_src_slot_time(src, src->frame_count + 1) - slot;
+    }
+
+    // Step 3: Take the newest paint, or repeat the previous frame
+    g_mutex_lock(&src->frame_mutex);
+    if (!src->pending_buffer && !src->last_buffer && !gst_chromium_src_wait_frame(src)) {
+        g_mutex_unlock(&src->frame_mutex);
+        GST_DEBUG_OBJECT(src, "Flushing");
+        return GST_FLOW_FLUSHING;
+    }
+    fresh = src->pending_buffer != NULL;
+    if (fresh) {
+        buffer = src->pending_buffer;
+        begin_time = src->pending_begin_time;
+        paint_time = src->pending_paint_time;
+        src->pending_buffer = NULL;
+        src->repeat_count = 0;
+    } else {
+        // Shares the frame's memory, so the pool frees rather than recycles
+        // the frame if it comes back while this repeat is still downstream
+        buffer = gst_buffer_copy(src->last_buffer);
+        src->frames_duplicated++;
+        src->repeat_count++;
+    }
+    g_mutex_unlock(&src->frame_mutex);
+
+    if (fresh && chromium_tracer_enabled()) {
+        chromium_tracer_record(GST_ELEMENT(src), CHROMIUM_TRACER_QUEUE, paint_time,
+            gst_util_get_timestamp());
+    }
+
+    // Let downstream measure how old the pixels are, e.g. render to encode latency
+    if (GST_CLOCK_TIME_IS_VALID(begin_time)) {
+        gst_buffer_add_reference_timestamp_meta(buffer, begin_frame_caps, begin_time,
+            GST_CLOCK_TIME_NONE);
+    }
+    if (GST_CLOCK_TIME_IS_VALID(paint_time)) {
+        gst_buffer_add_reference_timestamp_meta(buffer, paint_caps, paint_time,
+            GST_CLOCK_TIME_NONE);
+    }
+
+    // Tell downstream the frame is unchanged, e.g. to skip re-encoding it
+    if (!fresh) {
+        GstCustomMeta *meta = gst_buffer_add_custom_meta(buffer, GST_CHROMIUM_SRC_REPEAT_META_NAME);
+        gst_structure_set(gst_custom_meta_get_structure(meta),
+            "count", G_TYPE_UINT, src->repeat_count, NULL);
+    }
+
+    GST_BUFFER_PTS(buffer) = slot;
+    GST_BUFFER_DTS(buffer) = slot;
+    GST_BUFFER_DURATION(buffer) = duration;
+    GST_BUFFER_OFFSET(buffer) = src->frame_count;
+    GST_BUFFER_OFFSET_END(buffer) = src->frame_count + 1;
+    if (discont) {
+        GST_BUFFER_FLAG_SET(buffer, GST_BUFFER_FLAG_DISCONT);
+    }
+
+    // Keep the frame for repeats; the extra ref also keeps it read-only downstream
+    if (fresh) {
+        g_mutex_lock(&src->frame_mutex);
+        gst_buffer_replace(&src->last_buffer, buffer);
+        g_mutex_unlock(&src->frame_mutex);
+    }
+
+    g_mutex_lock(&src->frame_mutex);
+    src->frame_count++;
+    g_mutex_unlock(&src->frame_mutex);
+
+    GST_DEBUG_OBJECT(src,
+		"Pushing %s buffer: ts=%" GST_TIME_FORMAT " dur=%" GST_TIME_FORMAT,
+        fresh ? "new" : "repeated",
+        GST_TIME_ARGS(slot),
+        GST_TIME_ARGS(duration));
+
+    *outbuf = buffer;
+    return GST_FLOW_OK;
+}
+
+/**
+ * gst_chromium_src_open_browser:
  * @src: The GstChromiumSrc instance
  *
- * Starts the Chromium source by allocating the frame buffer, setting
- * caps on the internal appsrc, and launching the CEF browser instance
- * in a separate thread.
+ * Creates the browser and starts loading the page, unless a browser
+ * created with the current url, framerate and alpha-mode is already
+ * running; one created with other settings is replaced. It is created
+ * at the width and height properties and resized once caps are set.
  *
- * Invoked during the READY_TO_PAUSED state transition in
- * gst_chromium_src_change_state().
+ * Invoked from NULL_TO_READY so the page loads before streaming
+ * starts, and again from gst_chromium_src_start() to pick up
+ * properties changed in READY.
  *
- * Returns: TRUE on success, FALSE on failure
+ * Returns: TRUE if a browser is running, FALSE on failure
  */
-static gboolean gst_chromium_src_start(GstChromiumSrc *src) {
-    GstCaps *caps;
+static gboolean gst_chromium_src_open_browser(GstChromiumSrc *src) {
+    gchar *url, *config;
+    gboolean created, current;
 
-    GST_INFO_OBJECT(src, "Starting Chromium source: %s", src->url);
+    g_mutex_lock(&src->frame_mutex);
+    url = g_strdup(src->url);
+    config = gst_chromium_src_browser_config(src);
+    created = src->cef_client != NULL;
+    current = created && g_strcmp0(config, src->browser_config) == 0;
+    g_mutex_unlock(&src->frame_mutex);
 
-    // Step 1: Validate URL
-    if (!src->url) {
+    if (!url) {
         GST_ELEMENT_ERROR(src, RESOURCE, SETTINGS,
             ("No URL specified"), (NULL));
+        g_free(config);
         return FALSE;
     }
 
-    // Step 2: Allocate frame buffer
-    src->frame_size = src->width * src->height * 4;
-    src->frame_buffer = (guint8 *)g_malloc(src->frame_size);
-    if (!src->frame_buffer) {
-        GST_ELEMENT_ERROR(src, RESOURCE, NO_SPACE_LEFT,
-            ("Failed to allocate frame buffer"), (NULL));
-        return FALSE;
+    if (current) {
+        g_free(url);
+        g_free(config);
+        return TRUE;
     }
 
-    // Step 3: Configure caps
-    caps = gst_caps_new_simple("video/x-raw",
-        "format", G_TYPE_STRING, "BGRA",
-        "width", G_TYPE_INT, src->width,
-        "height", G_TYPE_INT, src->height,
-        "framerate", GST_TYPE_FRACTION, src->fps_num, 1,
-        NULL);
-
-    GST_INFO_OBJECT(src, "Setting caps: %" GST_PTR_FORMAT, caps);
-    gst_app_src_set_caps(src->appsrc, caps);
-    gst_caps_unref(caps);
+    if (created) {
+        GST_INFO_OBJECT(src, "Settings changed in READY, recreating browser");
+        cef_browser_stop(src);
+    }
 
-    // Step 4: Initialize state
-    src->running = TRUE;
-    src->frame_count = 0;
-    src->page_loaded = FALSE;
+    GST_INFO_OBJECT(src, "Creating browser for %s", url);
+    g_mutex_lock(&src->frame_mutex);
+    src->view_width = src->width;
+    src->view_height = src->height;
+    g_free(src->browser_config);
+    src->browser_config = config;
+    g_mutex_unlock(&src->frame_mutex);
 
-    // Step 5: Start CEF browser
-    if (!cef_browser_start(src, src->url, src->width, src->height)) {
+    if (!cef_browser_start(src, url, src->width, src->height)) {
         GST_ELEMENT_ERROR(src,
 			RESOURCE,
 			FAILED,
             ("Failed to start CEF browser"),
             (NULL));
+        g_mutex_lock(&src->frame_mutex);
         src->running = FALSE;
-        g_free(src->frame_buffer);
-        src->frame_buffer = NULL;
+        g_clear_pointer(&src->browser_config, g_free);
+        g_mutex_unlock(&src->frame_mutex);
+        g_free(url);
         return FALSE;
     }
 
-    GST_INFO_OBJECT(src, "Chromium source started successfully");
+    g_free(url);
     return TRUE;
 }
 
 /**
- * gst_chromium_src_stop:
+ * gst_chromium_src_close_browser:
  * @src: The GstChromiumSrc instance
  *
- * Stops the Chromium source by signaling the CEF thread to stop,
- * waiting for it to join, cleaning up CEF resources, freeing the
- * frame buffer, and sending EOS to the internal appsrc.
+ * Stops OnPaint() from delivering frames and closes the browser.
  *
- * Invoked during the PAUSED_TO_READY state transition in
- * gst_chromium_src_change_state().
- *
- * Returns: TRUE always
+ * Invoked during the READY_TO_NULL state transition, and by
+ * gst_chromium_src_stop() when keep-browser is off.
  */
-static gboolean gst_chromium_src_stop(GstChromiumSrc *src) {
-    GST_INFO_OBJECT(src, "Stopping Chromium source");
-
-    // Step 1: Signal thread to stop
+static void gst_chromium_src_close_browser(GstChromiumSrc *src) {
     g_mutex_lock(&src->frame_mutex);
     src->running = FALSE;
-    g_cond_signal(&src->frame_cond);
+    g_cond_broadcast(&src->frame_cond);
     g_mutex_unlock(&src->frame_mutex);
 
-    // Step 2: Stop CEF browser
     cef_browser_stop(src);
 
-    // Step 3: Free frame buffer
-    g_free(src->frame_buffer);
-    src->frame_buffer = NULL;
-    src->frame_size = 0;
-
-    // Step 4: Send EOS to appsrc
-    if (src->appsrc) {
-        gst_app_src_end_of_stream(src->appsrc);
-        DEBUG_LOG_GST("stop - EOS sent");
-    }
-
-    GST_INFO_OBJECT(src, "Chromium source stopped");
-    return TRUE;
+    g_mutex_lock(&src->frame_mutex);
+    g_clear_pointer(&src->browser_config, g_free);
+    g_mutex_unlock(&src->frame_mutex);
 }
 
 /**
  * gst_chromium_src_change_state:
  * @element: The GstElement instance
- * @transition: The state transition being performed
+ * @transition: The state transition
  *
- * Handles GStreamer state transitions. Calls gst_chromium_src_start()
- * when transitioning from READY to PAUSED, and gst_chromium_src_stop()
- * when transitioning from PAUSED to READY. Chains up to parent class
- * for default handling.
+ * Ties the browser to the READY state when keep-browser is set: it is
+ * created and navigated in NULL_TO_READY, so CEF startup, subprocess
+ * spawn and page load are done before PAUSED, and closed in
+ * READY_TO_NULL.
  *
- * Invoked by GStreamer pipeline when the element's state changes
- * (e.g., via gst_element_set_state()).
+ * Invoked by GStreamer for every state transition.
  *
- * Returns: The result of the state change
+ * Returns: The result of the transition
  */
-static GstStateChangeReturn gst_chromium_src_change_state(
-		GstElement *element,
-		GstStateChange transition) {
+static GstStateChangeReturn gst_chromium_src_change_state(GstElement *element,
+                                                          GstStateChange transition) {
     GstChromiumSrc *src = GST_CHROMIUM_SRC(element);
     GstStateChangeReturn ret;
 
-    switch (transition) {
-        case GST_STATE_CHANGE_NULL_TO_READY:
-            break;
-        case GST_STATE_CHANGE_READY_TO_PAUSED:
-            if (!gst_chromium_src_start(src)) {
-                return GST_STATE_CHANGE_FAILURE;
-            }
-            break;
-        case GST_STATE_CHANGE_PAUSED_TO_PLAYING:
-            break;
-        default:
-            break;
+    if (transition == GST_STATE_CHANGE_NULL_TO_READY && src->keep_browser &&
+        !gst_chromium_src_open_browser(src)) {
+        return GST_STATE_CHANGE_FAILURE;
     }
 
     ret = GST_ELEMENT_CLASS(parent_class)->change_state(element, transition);
 
-    switch (transition) {
-        case GST_STATE_CHANGE_PLAYING_TO_PAUSED:
-            break;
-        case GST_STATE_CHANGE_PAUSED_TO_READY:
-            gst_chromium_src_stop(src);
-            break;
-        case GST_STATE_CHANGE_READY_TO_NULL:
-            break;
-        default:
-            break;
+    if (transition == GST_STATE_CHANGE_READY_TO_NULL ||
+        (transition == GST_STATE_CHANGE_NULL_TO_READY && ret == GST_STATE_CHANGE_FAILURE)) {
+        gst_chromium_src_close_browser(src);
     }
 
     return ret;
 }
 
+/**
+ * gst_chromium_src_start:
+ * @basesrc: The GstBaseSrc instance
+ *
+ * Starts streaming from the browser created in NULL_TO_READY,
+ * recreating it if properties changed since, or creates one when
+ * keep-browser is off or it was closed by a previous stop. Frames are dropped by
+ * OnPaint() until caps are negotiated and a buffer pool is available.
+ *
+ * Invoked by GstBaseSrc during the READY_TO_PAUSED state transition.
+ *
+ * Returns: TRUE on success, FALSE on failure
+ */
+static gboolean gst_chromium_src_start(GstBaseSrc *basesrc) {
+    GstChromiumSrc *src = GST_CHROMIUM_SRC(basesrc);
+    gboolean loaded;
+
+    GST_INFO_OBJECT(src, "Starting Chromium source");
+
+    // Step 1: Make sure the browser matches the current settings
+    if (!gst_chromium_src_open_browser(src)) {
+        return FALSE;
+    }
+
+    // Step 2: Initialize state
+    g_mutex_lock(&src->frame_mutex);
+    src->flushing = FALSE;
+    src->frame_count = 0;
+    src->paint_count = 0;
+    src->bytes_copied = 0;
+    src->begin_frame_time = GST_CLOCK_TIME_NONE;
+    src->pending_begin_time = GST_CLOCK_TIME_NONE;
+    src->pending_paint_time = GST_CLOCK_TIME_NONE;
+    src->slot_origin = GST_CLOCK_TIME_NONE;
+    src->slot_index = 0;
+    src->repeat_count = 0;
+    src->frames_duplicated = 0;
+    src->frames_dropped = 0;
+    gst_chromium_src_reset_stats(src);
+    src->ready_deadline = -1;
+    if (src->ready_mode == GST_CHROMIUM_SRC_READY_NONE) {
+        src->page_ready = TRUE;
+    }
+    loaded = src->page_loaded;
+    g_mutex_unlock(&src->frame_mutex);
+
+    GST_INFO_OBJECT(src, "Chromium source started successfully%s",
+        loaded ? ", page already loaded" : "");
+    return TRUE;
+}
+
+/**
+ * gst_chromium_src_stop:
+ * @basesrc: The GstBaseSrc instance
+ *
+ * Stops streaming by releasing the pending frame and the reference on
+ * the buffer pool; without a pool OnPaint() drops paints. With
+ * keep-browser the browser stays loaded in READY and is closed by
+ * READY_TO_NULL, otherwise it is closed here.
+ *
+ * Invoked by GstBaseSrc during the PAUSED_TO_READY state transition,
+ * after streaming has been stopped.
+ *
+ * Returns: TRUE always
+ */
+static gboolean gst_chromium_src_stop(GstBaseSrc *basesrc) {
+    GstChromiumSrc *src = GST_CHROMIUM_SRC(basesrc);
+
+    GST_INFO_OBJECT(src, "Stopping Chromium source");
+
+    // Release pending frame and buffer pool
+    g_mutex_lock(&src->frame_mutex);
+    gst_clear_buffer(&src->pending_buffer);
+    gst_clear_buffer(&src->last_buffer);
+    gst_clear_object(&src->pool);
+    GST_INFO_OBJECT(src, "Pushed %" G_GUINT64_FORMAT " frames, %" G_GUINT64_FORMAT
+        " duplicated, %" G_GUINT64_FORMAT " dropped",
+        src->frame_count, src->frames_duplicated, src->frames_dropped);
+    if (src->paint_count > 0) {
+        GST_INFO_OBJECT(src, "Copied %" G_GUINT64_FORMAT " bytes in %" G_GUINT64_FORMAT
+            " paints (%" G_GUINT64_FORMAT " bytes/paint, full frame %" G_GSIZE_FORMAT ")",
+            src->bytes_copied, src->paint_count,
+            src->bytes_copied / src->paint_count, src->frame_size);
+    }
+    g_mutex_unlock(&src->frame_mutex);
+
+    if (!src->keep_browser) {
+        gst_chromium_src_close_browser(src);
+    }
+
+    GST_INFO_OBJECT(src, "Chromium source stopped");
+    return TRUE;
+}
+
 /**
  * plugin_init:
  * @plugin: The GStreamer plugin being initialized
  *
- * Registers the chromiumsrc element with GStreamer. This is the
+ * Registers the chromiumsrc element and the chromiumtrace tracer
+ * with GStreamer, and with CHROMIUMSRC_PREWARM=auto|true|false set
+ * starts initializing CEF in that GPU mode right away. This is the
  * plugin's entry point that makes the element available to
  * applications.
  *
@@ -566,13 +1818,35 @@ static GstStateChangeReturn gst_chromium_src_change_state(
  * Returns: TRUE on success, FALSE on failure
  */
 static gboolean plugin_init(GstPlugin *plugin) {
+    const gchar *prewarm = g_getenv("CHROMIUMSRC_PREWARM");
+
     // Initialize debug system with unique instance ID
     debug_init();
     DEBUG_LOG("=== Chromium Source Plugin Initialized ===");
     DEBUG_LOG("Plugin loaded - Instance ID: %s", debug_get_id());
-    
-    return gst_element_register(plugin, "chromiumsrc", GST_RANK_NONE,
-        GST_TYPE_CHROMIUM_SRC);
+
+    // Opt-in: start CEF now, but not in the registry scanner
+    if (prewarm && *prewarm && g_strcmp0(prewarm, "0") != 0) {
+        gchar *exe = g_file_read_link("/proc/self/exe", NULL);
+        if (!exe || !g_str_has_suffix(exe, "/gst-plugin-scanner")) {
+            cef_prewarm(prewarm);
+        }
+        g_free(exe);
+    }
+
+    if (!gst_element_register(plugin, "chromiumsrc", GST_RANK_NONE,
+            GST_TYPE_CHROMIUM_SRC)) {
+        return FALSE;
+    }
+
+#ifndef GST_DISABLE_GST_TRACER_HOOKS
+    // Feature names share one namespace, so the tracer cannot be "chromiumsrc"
+    if (!gst_tracer_register(plugin, "chromiumtrace", GST_TYPE_CHROMIUM_TRACER)) {
+        return FALSE;
+    }
+#endif
+
+    return TRUE;
 }
 
 GST_PLUGIN_DEFINE(
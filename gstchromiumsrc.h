@@ -2,7 +2,10 @@
 #define __GST_CHROMIUM_SRC_H__
 
 #include <gst/gst.h>
-#include <gst/app/gstappsrc.h>
+#include <gst/base/gstpushsrc.h>
+#include <gst/video/video.h>
+
+#include "frame_utils.h"
 
 G_BEGIN_DECLS
 
@@ -16,42 +19,143 @@ G_BEGIN_DECLS
 #define GST_IS_CHROMIUM_SRC_CLASS(klass) \
     (G_TYPE_CHECK_CLASS_TYPE((klass), GST_TYPE_CHROMIUM_SRC))
 
+/* Custom meta on buffers repeating the previous frame; its structure
+ * holds the number of consecutive repeats in the "count" field */
+#define GST_CHROMIUM_SRC_REPEAT_META_NAME "GstChromiumSrcRepeatMeta"
+
+/* GstReferenceTimestampMeta references on every buffer, both on the
+ * CLOCK_MONOTONIC timeline of gst_util_get_timestamp(): when Chromium was
+ * asked to begin the frame, and when OnPaint() received its pixels */
+#define GST_CHROMIUM_SRC_BEGIN_FRAME_CAPS "timestamp/x-chromiumsrc-begin-frame"
+#define GST_CHROMIUM_SRC_PAINT_CAPS "timestamp/x-chromiumsrc-paint"
+
+/* Element message posted when the page of a url changed at runtime has
+ * painted; fields "url" (string) and "http-status" (int) */
+#define GST_CHROMIUM_SRC_NAVIGATED_MESSAGE "chromiumsrc-navigated"
+
+#define GST_TYPE_CHROMIUM_SRC_ALPHA_MODE (gst_chromium_src_alpha_mode_get_type())
+
+/* How the alpha channel of Chromium's premultiplied BGRA paints is output */
+typedef enum {
+    GST_CHROMIUM_SRC_ALPHA_PREMULTIPLIED,
+    GST_CHROMIUM_SRC_ALPHA_STRAIGHT,
+    GST_CHROMIUM_SRC_ALPHA_OPAQUE
+} GstChromiumSrcAlphaMode;
+
+#define GST_TYPE_CHROMIUM_SRC_OUTPUT_MEMORY (gst_chromium_src_output_memory_get_type())
+
+/* Memory the output frames are allocated in */
+typedef enum {
+    GST_CHROMIUM_SRC_MEMORY_SYSTEM,
+    GST_CHROMIUM_SRC_MEMORY_MEMFD
+} GstChromiumSrcOutputMemory;
+
+#define GST_TYPE_CHROMIUM_SRC_READY_MODE (gst_chromium_src_ready_mode_get_type())
+
+/* What the first output frame waits for */
+typedef enum {
+    GST_CHROMIUM_SRC_READY_NONE,
+    GST_CHROMIUM_SRC_READY_LOAD,
+    GST_CHROMIUM_SRC_READY_SIGNAL
+} GstChromiumSrcReadyMode;
+
+/* Process message the renderer sends when the page calls
+ * window.chromiumsrc.ready() */
+#define GST_CHROMIUM_SRC_READY_MESSAGE "chromiumsrc-ready"
+
+/* Process message the renderer sends when the page calls
+ * window.chromiumsrc.frameDone() */
+#define GST_CHROMIUM_SRC_FRAME_DONE_MESSAGE "chromiumsrc-frame-done"
+
 typedef struct _GstChromiumSrc GstChromiumSrc;
 typedef struct _GstChromiumSrcClass GstChromiumSrcClass;
 
 struct _GstChromiumSrc {
-    GstBin    parent;
-    GstAppSrc *appsrc;
-    GstPad    *ghostpad;
+    GstPushSrc parent;
 
     gchar *url;
     gint  width;
     gint  height;
-    gint  fps_num;
+    gint  fps_n;
+    gint  fps_d;
     gint  gpu_device;
 
     gpointer cef_browser;
     gpointer cef_client;
+    gint     browser_generation;
+    gchar    *browser_config;
+    gint     view_width;
+    gint     view_height;
     GThread  *cef_thread;
 
-    guint8   *frame_buffer;
+    GstVideoInfo  info;
+    FrameFormat   frame_format;
+    FrameYuvMatrix yuv_matrix;
+    GstBufferPool *pool;
+    GstBuffer     *pending_buffer;
+    GstBuffer     *last_buffer;
+    GstClockID    clock_id;
     gsize    frame_size;
     GMutex   frame_mutex;
     GCond    frame_cond;
-    gboolean frame_ready;
     gboolean running;
+    gboolean flushing;
     gboolean page_loaded;
+    gboolean page_ready;
+    GstChromiumSrcReadyMode ready_mode;
+    guint    ready_timeout;
+    gint64   ready_deadline;
+    gboolean frame_sync;
+    gboolean frame_done_pending;
+    gboolean capture_paint;
+    guint    budget_granted;
+    guint    budget_expired;
+    guint    budget_frame;
+    gboolean timeline;
+    gboolean navigating;
+    gboolean repaint;
+    gboolean announce_navigation;
+    gchar    *navigation_url;
+    gint     navigation_status;
     gboolean gpu_enabled;
     gboolean gpu_user_specified;
+    gboolean dirty_rects;
+    gboolean invalidate;
+    gboolean keep_browser;
+    GstChromiumSrcAlphaMode alpha_mode;
+    GstChromiumSrcOutputMemory output_memory;
+
+    GstClockTime begin_frame_time;
+    GstClockTime pending_begin_time;
+    GstClockTime pending_paint_time;
+
+    GstClockTime slot_origin;
+    guint64 slot_index;
+    guint   repeat_count;
 
     guint64 frame_count;
+    guint64 paint_count;
+    guint64 bytes_copied;
+    guint64 frames_duplicated;
+    guint64 frames_dropped;
+    guint64 paints_received;
+    guint64 size_mismatches;
+    guint64 frame_timeouts;
+    GstClockTime last_paint_time;
+    GstClockTime paint_interval_min;
+    GstClockTime paint_interval_max;
+    GstClockTime paint_interval_sum;
+    guint64 paint_intervals;
 };
 
 struct _GstChromiumSrcClass {
-    GstBinClass parent_class;
+    GstPushSrcClass parent_class;
 };
 
 GType gst_chromium_src_get_type(void);
+GType gst_chromium_src_alpha_mode_get_type(void);
+GType gst_chromium_src_output_memory_get_type(void);
+GType gst_chromium_src_ready_mode_get_type(void);
 
 G_END_DECLS
 
@@ -0,0 +1,158 @@
+#include "memfd_allocator.h"
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/mman.h>
+#endif
+
+GST_DEBUG_CATEGORY_STATIC(memfd_allocator_debug);
+#define GST_CAT_DEFAULT memfd_allocator_debug
+
+#define GST_MEMFD_ALLOCATOR_NAME "chromiumsrc-memfd"
+
+G_DEFINE_TYPE(GstMemfdAllocator, gst_memfd_allocator, GST_TYPE_FD_ALLOCATOR);
+
+/**
+ * gst_memfd_allocator_create_fd:
+ * @size: Size of the file in bytes
+ *
+ * Creates an anonymous memfd of @size bytes and seals its size, so a
+ * consumer in another process can mmap it without guarding against
+ * the file being truncated under it.
+ *
+ * Returns: The file descriptor, or -1 on failure
+ */
+static gint gst_memfd_allocator_create_fd(gsize size) {
+#ifdef __linux__
+    gint fd = memfd_create(GST_MEMFD_ALLOCATOR_NAME, MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (fd < 0) {
+        GST_ERROR("memfd_create failed: %s", g_strerror(errno));
+        return -1;
+    }
+
+    if (ftruncate(fd, (off_t)size) < 0) {
+        GST_ERROR("ftruncate to %" G_GSIZE_FORMAT " bytes failed: %s", size, g_strerror(errno));
+        close(fd);
+        return -1;
+    }
+
+    if (fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL) < 0) {
+        GST_WARNING("Sealing memfd failed: %s", g_strerror(errno));
+    }
+
+    return fd;
+#else
+    GST_ERROR("memfd is only available on Linux");
+    return -1;
+#endif
+}
+
+/**
+ * gst_memfd_allocator_alloc:
+ * @allocator: The GstMemfdAllocator
+ * @size: Usable size requested
+ * @params: Allocation parameters (prefix, padding, alignment)
+ *
+ * Allocates one GstFdMemory backed by its own sealed memfd. The memory
+ * stays mapped for its lifetime, so pooled buffers are not re-mapped
+ * for every frame written into them.
+ *
+ * Invoked by gst_allocator_alloc(), typically from a buffer pool.
+ *
+ * Returns: The new memory, or NULL on failure
+ */
+static GstMemory *gst_memfd_allocator_alloc(GstAllocator *allocator, gsize size,
+                                            GstAllocationParams *params) {
+    gsize page = (gsize)sysconf(_SC_PAGESIZE);
+    gsize maxsize = params->prefix + size + params->padding;
+    GstMemory *mem;
+    gint fd;
+
+    // mmap offsets are page aligned, which covers any alignment requested
+    maxsize = (maxsize + page - 1) & ~(page - 1);
+
+    fd = gst_memfd_allocator_create_fd(maxsize);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    mem = gst_fd_allocator_alloc(allocator, fd, maxsize, GST_FD_MEMORY_FLAG_KEEP_MAPPED);
+    if (!mem) {
+        close(fd);
+        return NULL;
+    }
+    gst_memory_resize(mem, params->prefix, size);
+
+    GST_LOG_OBJECT(allocator, "Allocated memfd %d of %" G_GSIZE_FORMAT " bytes", fd, maxsize);
+
+    return mem;
+}
+
+/**
+ * gst_memfd_allocator_class_init:
+ * @klass: The class structure to initialize
+ *
+ * Installs the memfd backed alloc implementation on top of
+ * GstFdAllocator, which provides mapping and fd export.
+ */
+static void gst_memfd_allocator_class_init(GstMemfdAllocatorClass *klass) {
+    GstAllocatorClass *allocator_class = GST_ALLOCATOR_CLASS(klass);
+
+    GST_DEBUG_CATEGORY_INIT(memfd_allocator_debug, "chromiumsrc-memfd", 0,
+        "Chromium Source memfd allocator");
+
+    allocator_class->alloc = gst_memfd_allocator_alloc;
+}
+
+/**
+ * gst_memfd_allocator_init:
+ * @allocator: The instance to initialize
+ *
+ * Keeps the "fd" memory type of GstFdAllocator so consumers treat the
+ * memory like any other fd memory, but marks the allocator usable
+ * through gst_allocator_alloc(), which buffer pools rely on.
+ */
+static void gst_memfd_allocator_init(GstMemfdAllocator *allocator) {
+    GST_OBJECT_FLAG_UNSET(allocator, GST_ALLOCATOR_FLAG_CUSTOM_ALLOC);
+}
+
+/**
+ * gst_memfd_allocator_is_supported:
+ *
+ * Checks whether sealed memfds can be created on this system.
+ *
+ * Invoked by the element before choosing memfd output memory.
+ *
+ * Returns: TRUE if memfd allocation works
+ */
+gboolean gst_memfd_allocator_is_supported(void) {
+    static gsize supported = 0;
+
+    if (g_once_init_enter(&supported)) {
+        gint fd = gst_memfd_allocator_create_fd((gsize)sysconf(_SC_PAGESIZE));
+        if (fd >= 0) {
+            close(fd);
+        }
+        g_once_init_leave(&supported, fd >= 0 ? 2 : 1);
+    }
+
+    return supported == 2;
+}
+
+/**
+ * gst_memfd_allocator_new:
+ *
+ * Creates a memfd allocator.
+ *
+ * Returns: (transfer full): A new GstAllocator
+ */
+GstAllocator *gst_memfd_allocator_new(void) {
+    GstAllocator *allocator = GST_ALLOCATOR(g_object_new(GST_TYPE_MEMFD_ALLOCATOR, NULL));
+
+    gst_object_ref_sink(allocator);
+    return allocator;
+}
@@ -0,0 +1,33 @@
+#ifndef __MEMFD_ALLOCATOR_H__
+#define __MEMFD_ALLOCATOR_H__
+
+#include <gst/gst.h>
+#include <gst/allocators/gstfdmemory.h>
+
+G_BEGIN_DECLS
+
+#define GST_TYPE_MEMFD_ALLOCATOR (gst_memfd_allocator_get_type())
+#define GST_MEMFD_ALLOCATOR(obj) \
+    (G_TYPE_CHECK_INSTANCE_CAST((obj), GST_TYPE_MEMFD_ALLOCATOR, GstMemfdAllocator))
+#define GST_IS_MEMFD_ALLOCATOR(obj) \
+    (G_TYPE_CHECK_INSTANCE_TYPE((obj), GST_TYPE_MEMFD_ALLOCATOR))
+
+typedef struct _GstMemfdAllocator GstMemfdAllocator;
+typedef struct _GstMemfdAllocatorClass GstMemfdAllocatorClass;
+
+struct _GstMemfdAllocator {
+    GstFdAllocator parent;
+};
+
+struct _GstMemfdAllocatorClass {
+    GstFdAllocatorClass parent_class;
+};
+
+GType gst_memfd_allocator_get_type(void);
+
+gboolean gst_memfd_allocator_is_supported(void);
+GstAllocator *gst_memfd_allocator_new(void);
+
+G_END_DECLS
+
+#endif
@@ -27,11 +27,52 @@
 
 #include <include/cef_app.h>
 #include <include/cef_command_line.h>
+#include <include/cef_render_process_handler.h>
+#include <include/cef_v8.h>
 #include <glib.h>
 #include <string>
 #include <cstring>
 #include "gpu_utils.h"
 
+/* Must match GST_CHROMIUM_SRC_READY_MESSAGE and
+ * GST_CHROMIUM_SRC_FRAME_DONE_MESSAGE in gstchromiumsrc.h, which this
+ * binary does not include as it is not linked against GStreamer */
+#define READY_MESSAGE "chromiumsrc-ready"
+#define FRAME_DONE_MESSAGE "chromiumsrc-frame-done"
+
+/**
+ * CefSignalHandler - Backs window.chromiumsrc.ready() and frameDone()
+ *
+ * Forwards the call to the browser process as a process message. ready()
+ * releases the first output frame of chromiumsrc with ready-mode=signal,
+ * frameDone() lets it capture the current frame with frame-sync.
+ */
+class CefSignalHandler : public CefV8Handler
+{
+public:
+    explicit CefSignalHandler(const char* message) : message_(message)
+    {
+    }
+
+    bool Execute(const CefString& name,
+                 CefRefPtr<CefV8Value> object,
+                 const CefV8ValueList& arguments,
+                 CefRefPtr<CefV8Value>& retval,
+                 CefString& exception) override
+    {
+        CefRefPtr<CefFrame> frame = CefV8Context::GetCurrentContext()->GetFrame();
+        if (frame)
+        {
+            frame->SendProcessMessage(PID_BROWSER, CefProcessMessage::Create(message_));
+        }
+        return true;
+    }
+
+private:
+    const char* message_;
+    IMPLEMENT_REFCOUNTING(CefSignalHandler);
+};
+
 /**
  * CefSubprocessApp - CEF application handler for subprocess execution
  *
@@ -44,7 +85,7 @@
  *   - Disable sandboxing and GPU sandbox for containerized environments
  *   - Disable unnecessary features (extensions, sync, background networking)
  */
-class CefSubprocessApp : public CefApp
+class CefSubprocessApp : public CefApp, public CefRenderProcessHandler
 {
 public:
     CefSubprocessApp() : process_type_("unknown")
@@ -53,6 +94,45 @@ public:
 
     std::string GetProcessType() const { return process_type_; }
 
+    CefRefPtr<CefRenderProcessHandler> GetRenderProcessHandler() override
+    {
+        return this;
+    }
+
+    /**
+     * OnContextCreated:
+     * @browser: The browser owning the frame
+     * @frame: The frame whose JavaScript context was created
+     * @context: The new V8 context
+     *
+     * Exposes window.chromiumsrc.ready() and frameDone() to the main
+     * frame, so pages can tell chromiumsrc when they have finished
+     * rendering their first meaningful frame, and with frame-sync when
+     * the DOM is up to date for the current one.
+     *
+     * Invoked by CEF in the renderer process for every new context.
+     */
+    void OnContextCreated(CefRefPtr<CefBrowser> browser,
+                          CefRefPtr<CefFrame> frame,
+                          CefRefPtr<CefV8Context> context) override
+    {
+        if (!frame->IsMain())
+        {
+            return;
+        }
+
+        CefRefPtr<CefV8Value> chromiumsrc = CefV8Value::CreateObject(nullptr, nullptr);
+        chromiumsrc->SetValue("ready",
+                              CefV8Value::CreateFunction("ready", new CefSignalHandler(READY_MESSAGE)),
+                              V8_PROPERTY_ATTRIBUTE_READONLY);
+        chromiumsrc->SetValue("frameDone",
+                              CefV8Value::CreateFunction("frameDone",
+                                                         new CefSignalHandler(FRAME_DONE_MESSAGE)),
+                              V8_PROPERTY_ATTRIBUTE_READONLY);
+        context->GetGlobal()->SetValue("chromiumsrc", chromiumsrc,
+                                       V8_PROPERTY_ATTRIBUTE_READONLY);
+    }
+
     /**
          * OnBeforeCommandLineProcessing:
          * @process_type: Type of subprocess (renderer, gpu-process, utility, etc.)
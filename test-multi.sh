@@ -0,0 +1,46 @@
+#!/bin/bash
+#
+# Runs several chromiumsrc elements in one gst-launch process and checks that
+# every one of them holds the requested framerate.
+#
+# Usage: ./test-multi.sh [instances] [fps] [seconds] [url]
+#
+# Each instance feeds an fpsdisplaysink; the last reported average of every
+# sink must reach 90% of the requested framerate.
+
+INSTANCES=${1:-4}
+FPS=${2:-30}
+SECONDS_TO_RUN=${3:-20}
+URL=${4:-"file://$(cd "$(dirname "$0")" && pwd)/docs/test.html"}
+
+# One word per argument, so gst-launch escapes a url with spaces itself
+BRANCHES=()
+for i in $(seq 1 "$INSTANCES"); do
+    BRANCHES+=(chromiumsrc "url=$URL" width=1280 height=720 "framerate=$FPS"
+        ! fpsdisplaysink "name=fps$i" video-sink=fakesink text-overlay=false sync=true)
+done
+
+timeout -s INT "$SECONDS_TO_RUN" gst-launch-1.0 -e -v "${BRANCHES[@]}" 2>&1 \
+    | awk -v instances="$INSTANCES" -v fps="$FPS" '
+        match($0, /fps[0-9]+: last-message = .*average: [0-9.]+/) {
+            line = substr($0, RSTART, RLENGTH)
+            split(line, head, ":")
+            name = head[1]
+            sub(/.*average: /, "", line)
+            average[name] = line + 0
+        }
+        END {
+            failed = 0
+            for (i = 1; i <= instances; i++) {
+                name = "fps" i
+                if (!(name in average)) {
+                    printf "%s: no measurement\n", name
+                    failed = 1
+                } else {
+                    ok = average[name] >= 0.9 * fps
+                    printf "%s: average %.2f fps (%s)\n", name, average[name], ok ? "ok" : "FAIL"
+                    if (!ok) failed = 1
+                }
+            }
+            exit failed
+        }'